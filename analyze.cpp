@@ -0,0 +1,146 @@
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include "player.hpp"
+using namespace std;
+
+/*
+ * Multi-PV analysis of a position: the best moves with their scores and
+ * principal variations from a single search.
+ *
+ * usage: analyze [-d depth] [-n lines] [-b board -s Black|White] [-c]
+ *                [-t ms] [-p name=value] [moves]
+ *
+ * The position is the start position after moves, written like
+ * opening_moves ("f5d6c3"), or the 64 characters of -b in the same order as
+ * Board::setBoard. -c also scores every root move with its own full-window
+ * search and no transposition table, the way doABMinimaxMove used to, to
+ * check the scores and compare the time; both searches are then exact, with
+ * late-move reductions and pruning off, as a selective search depends on
+ * its window. -t searches ever deeper instead of
+ * to -d, and reports the deepest search that finished within ms. -p sets a
+ * search parameter, as in Player::setSearchParam, and may be repeated.
+ */
+
+static double msSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[]) {
+    int depth = 6;
+    int n = 4;
+    int ms = 0;
+    bool compare = false;
+    vector<string> settings;
+    string board_str = "";
+    string moves = "";
+    Side side = BLACK;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-d") && i + 1 < argc) depth = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc) n = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-b") && i + 1 < argc) board_str = argv[++i];
+        else if (!strcmp(argv[i], "-s") && i + 1 < argc) side = strcmp(argv[++i], "Black") ? WHITE : BLACK;
+        else if (!strcmp(argv[i], "-c")) compare = true;
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc) ms = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-p") && i + 1 < argc) settings.push_back(argv[++i]);
+        else if (argv[i][0] != '-') moves = argv[i];
+        else {
+            cerr << "usage: " << argv[0] << " [-d depth] [-n lines] [-b board -s Black|White]"
+                 << " [-c] [-t ms] [-p name=value] [moves]" << endl;
+            exit(-1);
+        }
+    }
+
+    Board board;
+    if (board_str.length() == 64) {
+        char data[64];
+        for (int i = 0; i < 64; ++i) data[i] = board_str[i];
+        board.setBoard(data);
+    } else if (board_str != "") {
+        cerr << "board must be 64 characters" << endl;
+        exit(-1);
+    } else {
+        // Replay the moves, passing for whoever has no move.
+        for (uint i = 0; i + 1 < moves.length(); i += 2) {
+            if (!board.hasMoves(side)) side = (side == BLACK) ? WHITE : BLACK;
+            Move m(tolower(moves[i]) - 'a', moves[i + 1] - '1');
+            if (!board.checkMove(&m, side)) {
+                cerr << "illegal move " << moves.substr(i, 2) << endl;
+                exit(-1);
+            }
+            board.doMove(&m, side);
+            side = (side == BLACK) ? WHITE : BLACK;
+        }
+        if (!board.hasMoves(side)) side = (side == BLACK) ? WHITE : BLACK;
+    }
+
+    Player player(side);
+    player.board = board;
+    for (uint i = 0; i < settings.size(); ++i) {
+        size_t eq = settings[i].find('=');
+        if (eq == string::npos ||
+            !player.setSearchParam(settings[i].substr(0, eq), atof(settings[i].c_str() + eq + 1))) {
+            cerr << "unknown search parameter " << settings[i] << endl;
+            exit(-1);
+        }
+    }
+    if (compare) {
+        player.params.lmr = false;
+        player.params.pruning = false;
+    }
+    player.allocateTables();
+
+    auto start = chrono::steady_clock::now();
+    vector<PVLine> lines;
+    if (ms > 0) {
+        // Each search starts again from depth 2, but the table makes the
+        // depths already searched cheap.
+        for (int d = 2; d <= BOARDSIZE * BOARDSIZE; d += 2) {
+            vector<PVLine> deeper = player.searchMultiPV(n, d);
+            if (msSince(start) > ms) break;
+            lines = deeper;
+            depth = d;
+        }
+    } else {
+        lines = player.searchMultiPV(n, depth);
+    }
+    double multi_ms = msSince(start);
+
+    cout << ((side == BLACK) ? "Black" : "White") << " to move, depth " << depth << endl;
+    for (uint k = 0; k < lines.size(); ++k) {
+        cout << k + 1 << ". " << lines[k].pv.substr(0, 2) << " " << lines[k].score
+             << "  " << lines[k].pv << endl;
+    }
+    cout << "multi-pv: " << multi_ms << " ms, " << player.nodes << " nodes" << endl;
+
+    if (compare) {
+        TranspositionTable *tt = player.tt;
+        player.tt = nullptr;
+        vector<double> scores;
+        start = chrono::steady_clock::now();
+        for (int i = 0; i < BOARDSIZE; ++i) {
+            for (int j = 0; j < BOARDSIZE; ++j) {
+                Move m(i, j);
+                if (board.checkMove(&m, side)) {
+                    scores.push_back(player.searchRootMove(&m, depth, LOW, HIGH));
+                }
+            }
+        }
+        double full_ms = msSince(start);
+        player.tt = tt;
+
+        sort(scores.begin(), scores.end(), greater<double>());
+        bool agree = true;
+        for (uint k = 0; k < lines.size(); ++k) {
+            agree = agree && (lines[k].score == scores[k]);
+        }
+        cout << "full-window searches of all " << scores.size() << " moves: " << full_ms
+             << " ms (" << full_ms / multi_ms << "x)" << endl;
+        if (!agree) {
+            cout << "MISMATCH between multi-pv and full-window scores" << endl;
+        }
+    }
+    return 0;
+}
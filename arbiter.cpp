@@ -0,0 +1,363 @@
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "board.hpp"
+using namespace std;
+
+/*
+ * Plays engine binaries against each other over the same stdin/stdout
+ * protocol as the Java WrapperPlayer: the engine is started with its side as
+ * the first argument, prints "Init done", then for every turn reads
+ * "x y msLeft" (-1 -1 for no move) and answers "x y" or "-1 -1". Unlike
+ * WrapperPlayer it waits on the pipe with poll instead of sleeping, so the
+ * clock only sees the engine's own time.
+ *
+ * usage: arbiter [-g games] [-t ms] [-j concurrent] [-m memory_kb]
+ *                [-l logfile] [-e] engineA engineB
+ *
+ * An engine is a shell command such as "./Cassio --mcts". -t 0 plays
+ * untimed (msLeft is sent as -1, and a move may take up to ten minutes).
+ * -m applies the same address space limit as the tournament's ulimit. -l
+ * writes one line per move with its time, -e passes the engines' stderr
+ * through. Colours alternate between games.
+ */
+
+#define INIT_TIMEOUT_MS 30000
+#define EXIT_TIMEOUT_MS 1000
+// An engine that hangs in an untimed game loses after this long on a move.
+#define UNTIMED_MOVE_TIMEOUT_MS 600000
+
+typedef chrono::steady_clock Clock;
+
+struct Engine {
+    pid_t pid;
+    int in;
+    int out;
+    string buffer;
+};
+
+struct Options {
+    int games = 2;
+    int ms = 60000;
+    int concurrent = 1;
+    long memory_kb = 0;
+    bool show_stderr = false;
+    FILE *log = nullptr;
+    string engines[2];
+};
+
+static mutex output_lock;
+
+/*
+ * Starts cmd with its side through the shell, with pipes on its stdin
+ * and stdout. Returns false if the process could not be created.
+ */
+static bool startEngine(const string &cmd, Side side, const Options &opts, Engine *e) {
+    int to_engine[2], from_engine[2];
+    // Close-on-exec so engines started concurrently don't hold each
+    // other's pipes open and hide EOF.
+    if (pipe2(to_engine, O_CLOEXEC) < 0) return false;
+    if (pipe2(from_engine, O_CLOEXEC) < 0) {
+        close(to_engine[0]);
+        close(to_engine[1]);
+        return false;
+    }
+    // The side goes straight after the program, where the wrapper expects
+    // it, ahead of any engine options.
+    size_t program_end = min(cmd.find(' '), cmd.size());
+    string command = "exec " + cmd.substr(0, program_end) + ((side == BLACK) ? " Black" : " White")
+                     + cmd.substr(program_end);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(to_engine[0], 0);
+        dup2(from_engine[1], 1);
+        if (!opts.show_stderr) {
+            int null = open("/dev/null", O_WRONLY);
+            dup2(null, 2);
+        }
+        if (opts.memory_kb > 0) {
+            struct rlimit limit;
+            limit.rlim_cur = limit.rlim_max = (rlim_t) opts.memory_kb << 10;
+            setrlimit(RLIMIT_AS, &limit);
+        }
+        execl("/bin/sh", "sh", "-c", command.c_str(), (char *) nullptr);
+        _exit(127);
+    }
+
+    close(to_engine[0]);
+    close(from_engine[1]);
+    if (pid < 0) {
+        close(to_engine[1]);
+        close(from_engine[0]);
+        return false;
+    }
+    e->pid = pid;
+    e->in = to_engine[1];
+    e->out = from_engine[0];
+    e->buffer.clear();
+    return true;
+}
+
+/*
+ * Reads one line from the engine, waiting at most timeout_ms (forever if
+ * negative). Returns 1 on success, 0 on timeout and -1 if the engine closed
+ * its stdout.
+ */
+static int readLine(Engine &e, string *line, int timeout_ms) {
+    Clock::time_point deadline = Clock::now() + chrono::milliseconds(timeout_ms);
+    while (true) {
+        size_t end = e.buffer.find('\n');
+        if (end != string::npos) {
+            *line = e.buffer.substr(0, end);
+            e.buffer.erase(0, end + 1);
+            return 1;
+        }
+
+        int wait = -1;
+        if (timeout_ms >= 0) {
+            auto left = chrono::duration_cast<chrono::milliseconds>(deadline - Clock::now()).count();
+            if (left < 0) return 0;
+            // Round up so a poll that returns early can't spin.
+            wait = (int) left + 1;
+        }
+        struct pollfd pfd = {e.out, POLLIN, 0};
+        int ready = poll(&pfd, 1, wait);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready < 0) return -1;
+        if (ready == 0) {
+            if (Clock::now() >= deadline) return 0;
+            continue;
+        }
+
+        char chunk[256];
+        ssize_t n = read(e.out, chunk, sizeof(chunk));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        e.buffer.append(chunk, n);
+    }
+}
+
+static bool writeLine(Engine &e, const string &line) {
+    const char *p = line.c_str();
+    size_t left = line.size();
+    while (left > 0) {
+        ssize_t n = write(e.in, p, left);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        left -= n;
+    }
+    return true;
+}
+
+/*
+ * Closes the engine's stdin so that its read loop ends, gives it a moment
+ * to exit and kills it if it doesn't.
+ */
+static void stopEngine(Engine &e) {
+    close(e.in);
+    string line;
+    while (readLine(e, &line, EXIT_TIMEOUT_MS) > 0) {
+    }
+    if (waitpid(e.pid, nullptr, WNOHANG) == 0) {
+        kill(e.pid, SIGKILL);
+        waitpid(e.pid, nullptr, 0);
+    }
+    close(e.out);
+}
+
+static double msSince(Clock::time_point start) {
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+struct GameResult {
+    int score;          // Black's disc lead, -64 or 64 on a forfeit.
+    string conclusion;
+    double used[2];     // Milliseconds, indexed by Side.
+    int moves;
+};
+
+/*
+ * Plays game number g between the two commands. Every move goes to the log
+ * as it is made.
+ */
+static GameResult playGame(int g, const string &black_cmd, const string &white_cmd,
+                           const Options &opts) {
+    GameResult r;
+    r.score = 0;
+    r.used[BLACK] = r.used[WHITE] = 0;
+    r.moves = 0;
+
+    Engine engines[2];
+    bool started[2] = {false, false};
+    const string *cmds[2] = {&white_cmd, &black_cmd};
+    string line;
+
+    for (Side side : {BLACK, WHITE}) {
+        started[side] = startEngine(*cmds[side], side, opts, &engines[side]);
+        if (!started[side] || readLine(engines[side], &line, INIT_TIMEOUT_MS) != 1) {
+            r.score = (side == BLACK) ? -64 : 64;
+            r.conclusion = string((side == BLACK) ? "black" : "white") + " failed to start";
+            for (int s = 0; s < 2; s++) if (started[s]) stopEngine(engines[s]);
+            return r;
+        }
+    }
+
+    Board board;
+    Side turn = BLACK;
+    int last_x = -1, last_y = -1;
+    while (!board.isDone()) {
+        Engine &e = engines[turn];
+        const char *name = (turn == BLACK) ? "black" : "white";
+        // Never send a negative time, which would read as "no limit".
+        int ms_left = (opts.ms > 0) ? max(0, (int) (opts.ms - r.used[turn])) : -1;
+
+        char request[64];
+        snprintf(request, sizeof(request), "%d %d %d\n", last_x, last_y, ms_left);
+        Clock::time_point start = Clock::now();
+        int timeout = (ms_left >= 0) ? ms_left : UNTIMED_MOVE_TIMEOUT_MS;
+        int status = writeLine(e, request) ? readLine(e, &line, timeout) : -1;
+        double elapsed = msSince(start);
+        r.used[turn] += elapsed;
+
+        // readLine may hand back a line that was already buffered, or one
+        // that came in within its rounding, after the clock ran out.
+        if (status == 1 && ms_left >= 0 && elapsed > ms_left) {
+            status = 0;
+        }
+
+        int x = -1, y = -1;
+        if (status == 1 && sscanf(line.c_str(), "%d %d", &x, &y) != 2) {
+            status = -2;
+        }
+        // Engine output is not trusted: only "-1 -1" passes, and anything
+        // else off the board is illegal before it gets near the Board.
+        bool pass = (x == -1 && y == -1);
+        bool on_board = (x >= 0 && x < BOARDSIZE && y >= 0 && y < BOARDSIZE);
+        if (status == 1 && !pass && !on_board) {
+            status = -3;
+        }
+        Move m(x, y);
+        if (status == 1 && !board.checkMove(pass ? nullptr : &m, turn)) {
+            status = -3;
+        }
+
+        if (opts.log != nullptr) {
+            lock_guard<mutex> guard(output_lock);
+            fprintf(opts.log, "%d\t%d\t%s\t%d %d\t%.3f\t%d\n", g + 1, r.moves + 1, name,
+                    x, y, elapsed, ms_left);
+        }
+
+        if (status != 1) {
+            r.score = (turn == BLACK) ? -64 : 64;
+            r.conclusion = string(name) + ((status == 0) ? " ran out of time"
+                                         : (status == -1) ? " exited"
+                                         : (status == -2) ? " sent \"" + line + "\""
+                                         : " made an illegal move");
+            break;
+        }
+
+        board.doMove(pass ? nullptr : &m, turn);
+        last_x = x;
+        last_y = y;
+        r.moves++;
+        turn = (turn == BLACK) ? WHITE : BLACK;
+    }
+
+    if (r.conclusion.empty()) {
+        r.score = board.countBlack() - board.countWhite();
+        r.conclusion = "normal";
+    }
+    stopEngine(engines[BLACK]);
+    stopEngine(engines[WHITE]);
+    return r;
+}
+
+int main(int argc, char *argv[]) {
+    Options opts;
+    const char *log_file = nullptr;
+    vector<string> engines;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-g") && i + 1 < argc) opts.games = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc) opts.ms = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-j") && i + 1 < argc) opts.concurrent = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-m") && i + 1 < argc) opts.memory_kb = atol(argv[++i]);
+        else if (!strcmp(argv[i], "-l") && i + 1 < argc) log_file = argv[++i];
+        else if (!strcmp(argv[i], "-e")) opts.show_stderr = true;
+        else engines.push_back(argv[i]);
+    }
+    if (engines.size() != 2 || opts.concurrent < 1) {
+        cerr << "usage: " << argv[0] << " [-g games] [-t ms] [-j concurrent] [-m memory_kb]"
+             << " [-l logfile] [-e] engineA engineB" << endl;
+        exit(-1);
+    }
+    opts.engines[0] = engines[0];
+    opts.engines[1] = engines[1];
+
+    if (log_file != nullptr) {
+        opts.log = fopen(log_file, "w");
+        if (opts.log == nullptr) {
+            perror(log_file);
+            exit(-1);
+        }
+        fprintf(opts.log, "game\tply\tside\tmove\tms\tms_left\n");
+    }
+
+    // A write to an engine that has died must fail, not kill the arbiter.
+    signal(SIGPIPE, SIG_IGN);
+
+    atomic<int> next_game(0);
+    int wins = 0, losses = 0, draws = 0, moves = 0;
+    double a_ms = 0, b_ms = 0;
+    Clock::time_point start = Clock::now();
+
+    auto worker = [&]() {
+        for (int g = next_game++; g < opts.games; g = next_game++) {
+            bool a_black = (g % 2 == 0);
+            GameResult r = playGame(g, opts.engines[a_black ? 0 : 1],
+                                    opts.engines[a_black ? 1 : 0], opts);
+            int a_result = a_black ? r.score : -r.score;
+
+            lock_guard<mutex> guard(output_lock);
+            if (a_result > 0) wins++;
+            else if (a_result < 0) losses++;
+            else draws++;
+            moves += r.moves;
+            a_ms += r.used[a_black ? BLACK : WHITE];
+            b_ms += r.used[a_black ? WHITE : BLACK];
+
+            cout << "game " << g + 1 << ": " << opts.engines[0] << " as "
+                 << (a_black ? "black" : "white") << " " << (a_result > 0 ? "+" : "")
+                 << a_result << ", " << r.conclusion << " (black " << (int) r.used[BLACK]
+                 << " ms, white " << (int) r.used[WHITE] << " ms)" << endl;
+        }
+    };
+
+    vector<thread> threads;
+    for (int i = 0; i < opts.concurrent; i++) threads.push_back(thread(worker));
+    for (uint i = 0; i < threads.size(); i++) threads[i].join();
+
+    double wall = msSince(start);
+    cout << opts.engines[0] << " vs " << opts.engines[1] << ": +" << wins << " -" << losses
+         << " =" << draws << ", time used " << (int) a_ms << " / " << (int) b_ms << " ms" << endl;
+    cout << opts.games << " games, " << moves << " moves in " << (int) wall << " ms" << endl;
+
+    if (opts.log != nullptr) fclose(opts.log);
+    return 0;
+}
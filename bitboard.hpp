@@ -0,0 +1,126 @@
+#ifndef __BITBOARD_H__
+#define __BITBOARD_H__
+
+#include <cstdint>
+
+/*
+ * Move generation on raw 64-bit boards, bit x + 8 * y per square, in the
+ * same layout as Board::getBlack()/getWhite(). P holds the stones of the
+ * side to move and O those of its opponent. These are for the hot loops that
+ * cannot afford Board's square-by-square checkMove (random playouts,
+ * position hashing, endgame search).
+ */
+
+#define BB_NOT_A 0xfefefefefefefefeULL
+#define BB_NOT_H 0x7f7f7f7f7f7f7f7fULL
+
+/*
+ * Shifts every stone one step in direction dir (0-7), dropping stones that
+ * would wrap around an edge of the board.
+ */
+static inline uint64_t bbShift(uint64_t b, int dir)
+{
+    switch (dir)
+    {
+        case 0: return (b << 1) & BB_NOT_A;  // x + 1
+        case 1: return (b >> 1) & BB_NOT_H;  // x - 1
+        case 2: return b << 8;               // y + 1
+        case 3: return b >> 8;               // y - 1
+        case 4: return (b << 9) & BB_NOT_A;  // x + 1, y + 1
+        case 5: return (b << 7) & BB_NOT_H;  // x - 1, y + 1
+        case 6: return (b >> 7) & BB_NOT_A;  // x + 1, y - 1
+        default: return (b >> 9) & BB_NOT_H; // x - 1, y - 1
+    }
+}
+
+/*
+ * Returns the set of squares where the side owning P can legally play.
+ */
+static inline uint64_t bbMoves(uint64_t P, uint64_t O)
+{
+    uint64_t empty = ~(P | O);
+    uint64_t moves = 0;
+    for (int dir = 0; dir < 8; ++dir)
+    {
+        uint64_t x = bbShift(P, dir) & O;
+        x |= bbShift(x, dir) & O;
+        x |= bbShift(x, dir) & O;
+        x |= bbShift(x, dir) & O;
+        x |= bbShift(x, dir) & O;
+        x |= bbShift(x, dir) & O;
+        moves |= bbShift(x, dir) & empty;
+    }
+    return moves;
+}
+
+/*
+ * Returns the stones of O that flip when the side owning P plays on sq.
+ * Zero means the move is illegal.
+ */
+static inline uint64_t bbFlips(uint64_t P, uint64_t O, int sq)
+{
+    uint64_t flips = 0;
+    for (int dir = 0; dir < 8; ++dir)
+    {
+        uint64_t line = 0;
+        uint64_t x = bbShift(1ULL << sq, dir);
+        while (x & O)
+        {
+            line |= x;
+            x = bbShift(x, dir);
+        }
+        if (x & P)
+        {
+            flips |= line;
+        }
+    }
+    return flips;
+}
+
+static inline int bbCount(uint64_t b)
+{
+    return __builtin_popcountll(b);
+}
+
+/*
+ * Board symmetries: y -> 7 - y, x -> 7 - x and x <-> y. Composing them gives
+ * all eight symmetries of the square.
+ */
+static inline uint64_t bbFlipVertical(uint64_t b)
+{
+    return __builtin_bswap64(b);
+}
+
+static inline uint64_t bbMirrorHorizontal(uint64_t b)
+{
+    b = ((b >> 1) & 0x5555555555555555ULL) | ((b & 0x5555555555555555ULL) << 1);
+    b = ((b >> 2) & 0x3333333333333333ULL) | ((b & 0x3333333333333333ULL) << 2);
+    b = ((b >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((b & 0x0f0f0f0f0f0f0f0fULL) << 4);
+    return b;
+}
+
+static inline uint64_t bbFlipDiagonal(uint64_t b)
+{
+    uint64_t t;
+    t = 0x0f0f0f0f00000000ULL & (b ^ (b << 28));
+    b ^= t ^ (t >> 28);
+    t = 0x3333000033330000ULL & (b ^ (b << 14));
+    b ^= t ^ (t >> 14);
+    t = 0x5500550055005500ULL & (b ^ (b << 7));
+    b ^= t ^ (t >> 7);
+    return b;
+}
+
+/*
+ * Applies symmetry sym (0-7) to b. Bit 0 mirrors x, bit 1 flips y and bit 2
+ * swaps x and y first.
+ */
+static inline uint64_t bbSymmetry(uint64_t b, int sym)
+{
+    if (sym & 4) b = bbFlipDiagonal(b);
+    if (sym & 2) b = bbFlipVertical(b);
+    if (sym & 1) b = bbMirrorHorizontal(b);
+    return b;
+}
+
+#endif
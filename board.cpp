@@ -1,31 +1,25 @@
 #include "board.hpp"
+#include "profiler.hpp"
+#include "tables.hpp"
 #include <iostream>
 #include <string>
+#include <cstring>
 
-// Adapted from:
-// https://courses.cs.washington.edu/courses/cse573/04au/Project/mini1/RUSSIA/Final_Paper.pdf
-const int static_scores[64] = 
-{
-       20, -3, 11, 8, 8, 11, -3, 20,
-      -3, -7, -4, 1, 1, -4, -7, -3,
-       11, -4, 2, 2, 2, 2, -4, 11,
-       8, 1, 2, -3, -3, 2, 1, 8,
-       8, 1, 2, -3, -3, 2, 1, 8,
-       11, -4, 2, 2, 2, 2, -4, 11,
-      -3, -7, -4, 1, 1, -4, -7, -3,
-       20, -3, 11, 8, 8, 11, -3, 20
-};
+// static_scores and the other lookup tables live in tables.hpp.
 
 /*
  * Make a standard BOARDSIZExBOARDSIZE othello board and initialize it to the standard setup.
  */
 Board::Board() {
+    nnue = nullptr;
     taken.set(3 + BOARDSIZE * 3);
     taken.set(3 + BOARDSIZE * 4);
     taken.set(4 + BOARDSIZE * 3);
     taken.set(4 + BOARDSIZE * 4);
     black.set(4 + BOARDSIZE * 3);
     black.set(3 + BOARDSIZE * 4);
+    refreshAccumulator();
+    refreshHash();
 }
 
 /*
@@ -39,8 +33,7 @@ Board::~Board() {
  */
 Board *Board::copy() {
     Board *newBoard = new Board();
-    newBoard->black = black;
-    newBoard->taken = taken;
+    *newBoard = *this;
     return newBoard;
 }
 
@@ -87,6 +80,7 @@ bool Board::hasMoves(Side side) {
  * Returns true if a move is legal for the given side; false otherwise.
  */
 bool Board::checkMove(Move *m, Side side) {
+    PROFILE_SCOPE(PHASE_MOVEGEN);
     // Passing is only legal if you have no moves.
     if (m == nullptr) return !hasMoves(side);
 
@@ -121,6 +115,7 @@ bool Board::checkMove(Move *m, Side side) {
  * Modifies the board to reflect the specified move.
  */
 void Board::doMove(Move *m, Side side) {
+    PROFILE_SCOPE(PHASE_MAKE);
     // A nullptr move means pass.
     if (m == nullptr) return;
 
@@ -129,6 +124,7 @@ void Board::doMove(Move *m, Side side) {
 
     int X = m->getX();
     int Y = m->getY();
+    int first_flipped = m->num_flipped;
     Side other = (side == BLACK) ? WHITE : BLACK;
     for (int dx = -1; dx <= 1; dx++) {
         for (int dy = -1; dy <= 1; dy++) {
@@ -157,11 +153,41 @@ void Board::doMove(Move *m, Side side) {
         }
     }
     set(side, X, Y);
+
+    hash ^= zobrist.square[side][X + BOARDSIZE * Y];
+    for (int i = first_flipped; i < m->num_flipped; ++i) {
+        hash ^= zobrist.square[BLACK][m->flipped[i]] ^ zobrist.square[WHITE][m->flipped[i]];
+    }
+
+    if (nnue != nullptr) {
+        nnueUpdate(nnue, accumulator, side, X + BOARDSIZE * Y, true);
+        for (int i = first_flipped; i < m->num_flipped; ++i) {
+            nnueUpdate(nnue, accumulator, side, m->flipped[i], true);
+            nnueUpdate(nnue, accumulator, other, m->flipped[i], false);
+        }
+    }
 }
 
 void Board::undoMove(Move *m) {
-    taken.set(m->getX() + m->getY() * BOARDSIZE, 0);
-    black.set(m->getX() + m->getY() * BOARDSIZE, 0);
+    PROFILE_SCOPE(PHASE_MAKE);
+    int sq = m->getX() + m->getY() * BOARDSIZE;
+    Side side = black[sq] ? BLACK : WHITE;
+    hash ^= zobrist.square[side][sq];
+    for (int i = 0; i < m->num_flipped; ++i) {
+        hash ^= zobrist.square[BLACK][m->flipped[i]] ^ zobrist.square[WHITE][m->flipped[i]];
+    }
+
+    if (nnue != nullptr) {
+        Side other = (side == BLACK) ? WHITE : BLACK;
+        nnueUpdate(nnue, accumulator, side, sq, false);
+        for (int i = 0; i < m->num_flipped; ++i) {
+            nnueUpdate(nnue, accumulator, side, m->flipped[i], false);
+            nnueUpdate(nnue, accumulator, other, m->flipped[i], true);
+        }
+    }
+
+    taken.set(sq, 0);
+    black.set(sq, 0);
     for (int i = 0; i < m->num_flipped; ++i) {
         black.flip(m->flipped[i]);
     }
@@ -203,6 +229,87 @@ void Board::setBoard(char data[]) {
             taken.set(i);
         }
     }
+    refreshAccumulator();
+    refreshHash();
+}
+
+/*
+ * Makes the board keep an accumulator for weights from now on, or for no
+ * network if weights is nullptr; getNNUEScore needs one.
+ */
+void Board::setNetwork(const NNUEWeights *weights) {
+    if (weights == nnue) return;
+    nnue = weights;
+    refreshAccumulator();
+}
+
+/*
+ * Recomputes the NNUE accumulator from scratch. Needed whenever the stones
+ * change other than through doMove/undoMove.
+ */
+void Board::refreshAccumulator() {
+    if (nnue == nullptr) return;
+
+    memcpy(accumulator, nnue->input_bias, sizeof(accumulator));
+    for (int i = 0; i < BOARDSIZE * BOARDSIZE; i++) {
+        if (taken[i]) {
+            nnueUpdate(nnue, accumulator, black[i] ? BLACK : WHITE, i, true);
+        }
+    }
+}
+
+/*
+ * Recomputes the Zobrist hash from scratch.
+ */
+void Board::refreshHash() {
+    hash = 0;
+    for (int i = 0; i < BOARDSIZE * BOARDSIZE; i++) {
+        if (taken[i]) {
+            hash ^= zobrist.square[black[i] ? BLACK : WHITE][i];
+        }
+    }
+}
+
+/*
+ * Returns the Zobrist hash of the stones. It does not include the side to
+ * move, which callers mix in with zobrist.side.
+ */
+uint64_t Board::getHash() {
+    return hash;
+}
+
+/*
+ * NNUE evaluation of the position from black's point of view, in the same
+ * units as getBoardScore.
+ */
+double Board::getNNUEScore() {
+    PROFILE_SCOPE(PHASE_EVAL);
+    return nnueEvaluate(nnue, accumulator) * NNUE_EVAL_SCALE;
+}
+
+/*
+ * Returns the black stones as a bitboard, bit x + BOARDSIZE * y per square.
+ */
+uint64_t Board::getBlack() {
+    return black.to_ullong();
+}
+
+/*
+ * Returns the white stones as a bitboard, bit x + BOARDSIZE * y per square.
+ */
+uint64_t Board::getWhite() {
+    return (taken & ~black).to_ullong();
+}
+
+/*
+ * Sets the board state from a pair of bitboards, as produced by getBlack()
+ * and getWhite(). Used to ship positions between processes.
+ */
+void Board::setBitboards(uint64_t black_bits, uint64_t white_bits) {
+    black = bitset<64>(black_bits);
+    taken = bitset<64>(black_bits | white_bits);
+    refreshAccumulator();
+    refreshHash();
 }
 
 int Board::getDiffScore(Side side)
@@ -231,6 +338,7 @@ int Board::numValidMoves(Side side)
 
 double Board::getBoardScore(Side side)
 {
+    PROFILE_SCOPE(PHASE_EVAL);
     Move* possible;
     double white_count = 0;
     double black_count = 0;
@@ -308,8 +416,8 @@ double Board::getBoardScore(Side side)
     double white_corners = 0;
     double black_cc = 0;
     double white_cc = 0;
-    double initial[4] = {0, 7, 56, 63};
-    double to_check[4][3] = {{1, 8, 9}, {6, 14, 15}, {48, 49, 57}, {54, 55, 62}};
+    static constexpr int initial[4] = {0, 7, 56, 63};
+    static constexpr int to_check[4][3] = {{1, 8, 9}, {6, 14, 15}, {48, 49, 57}, {54, 55, 62}};
     for (int i = 0; i < 4; ++i)
     {
         if (taken[initial[i]])
@@ -373,11 +481,12 @@ double Board::getBoardScore(Side side)
 
 double Board::getBlackBoardScore()
 {
+    PROFILE_SCOPE(PHASE_EVAL);
     int black_score = 0, white_score = 0, black_frontiers = 0, white_frontiers = 0;
     double diff = 0, corners = 0, corner_diff = 0, mobility = 0, frontiers = 0, state = 0;
 
-    int X1[] = {-1, -1, 0, 1, 1, 1, 0, -1};
-    int Y1[] = {0, 1, 1, 1, 0, -1, -1, -1};
+    static constexpr int X1[] = {-1, -1, 0, 1, 1, 1, 0, -1};
+    static constexpr int Y1[] = {0, 1, 1, 1, 0, -1, -1, -1};
 
     for(int i = 0; i < BOARDSIZE; ++i)
     {
@@ -435,8 +544,8 @@ double Board::getBlackBoardScore()
         frontiers = (100.0 * white_frontiers) / (black_frontiers + white_frontiers);
     }
 
-    int X2[] = {0, 0, 7, 7};
-    int Y2[] = {0, 7, 0, 7};
+    static constexpr int X2[] = {0, 0, 7, 7};
+    static constexpr int Y2[] = {0, 7, 0, 7};
 
     black_score = white_score = 0;
     for (int i = 0; i < 4; ++i)
@@ -452,8 +561,8 @@ double Board::getBlackBoardScore()
     }
     corners = 25 * (black_score - white_score);
 
-    int X3[4][3] = {{0, 1, 1}, {0, 1, 1}, {7, 6, 6}, {6, 6, 7}};
-    int Y3[4][3] = {{1, 1, 0}, {6, 6, 7}, {1, 1, 0}, {7, 6, 6}};
+    static constexpr int X3[4][3] = {{0, 1, 1}, {0, 1, 1}, {7, 6, 6}, {6, 6, 7}};
+    static constexpr int Y3[4][3] = {{1, 1, 0}, {6, 6, 7}, {1, 1, 0}, {7, 6, 6}};
     black_score = white_score = 0;
 
     for (int i = 0; i < 4; ++i)
@@ -2,7 +2,9 @@
 #define __BOARD_H__
 
 #include <bitset>
+#include <cstdint>
 #include "common.hpp"
+#include "nnue.hpp"
 #include <string>
 using namespace std;
 
@@ -12,6 +14,15 @@ private:
     bitset<64> black;
     bitset<64> taken;
 
+    // First layer of the NNUE evaluation, kept up to date while nnue is
+    // set. Copies of the board share the network.
+    const NNUEWeights *nnue;
+    int16_t accumulator[NNUE_HIDDEN];
+
+    // Zobrist hash of the stones, kept up to date by doMove/undoMove.
+    uint64_t hash;
+
+    void refreshHash();
     bool occupied(int x, int y);
     bool get(Side side, int x, int y);
     void set(Side side, int x, int y);
@@ -39,6 +50,14 @@ public:
     double getBlackBoardScore();
 
     void setBoard(char data[]);
+    void setNetwork(const NNUEWeights *weights);
+    void refreshAccumulator();
+    double getNNUEScore();
+
+    uint64_t getHash();
+    uint64_t getBlack();
+    uint64_t getWhite();
+    void setBitboards(uint64_t black_bits, uint64_t white_bits);
 };
 
 #endif
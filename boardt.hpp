@@ -0,0 +1,239 @@
+#ifndef __BOARDT_H__
+#define __BOARDT_H__
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include "common.hpp"
+
+using namespace std;
+
+/*
+ * Othello on an N x N board, for the size-generic tools (perft, the exact
+ * solver and the small-board match in boardtool). Board in board.hpp stays
+ * the engine's 8x8 board, with its NNUE accumulator, Zobrist hash and
+ * tuned evaluation; BoardT<8> plays the same game and boardtool checks the
+ * two against each other.
+ *
+ * Square x + N * y is bit x + N * y. Boards up to 8x8 fit a uint64_t and
+ * 10x10 an unsigned __int128, which GCC lowers to pairs of 64-bit
+ * operations.
+ */
+
+__extension__ typedef unsigned __int128 uint128_t;
+
+template <int N>
+struct BoardBits
+{
+    static_assert(N >= 4 && N <= 10 && N % 2 == 0, "unsupported board size");
+    typedef typename conditional<(N * N <= 64), uint64_t, uint128_t>::type type;
+};
+
+template <int N>
+class BoardT
+{
+public:
+    typedef typename BoardBits<N>::type Bits;
+
+    static constexpr int SQUARES = N * N;
+
+    Bits black;
+    Bits white;
+
+    /*
+     * The standard start: four stones in the middle, black on the
+     * (N/2, N/2 - 1) diagonal as on the 8x8 board.
+     */
+    BoardT()
+    {
+        int c = N / 2;
+        black = bit(c + N * (c - 1)) | bit(c - 1 + N * c);
+        white = bit(c - 1 + N * (c - 1)) | bit(c + N * c);
+    }
+
+    static Bits bit(int sq)
+    {
+        return (Bits) 1 << sq;
+    }
+
+    static constexpr Bits fullMask()
+    {
+        Bits m = 0;
+        for (int sq = 0; sq < SQUARES; ++sq)
+        {
+            m |= (Bits) 1 << sq;
+        }
+        return m;
+    }
+
+    // Every square except those in column x.
+    static constexpr Bits notColumn(int x)
+    {
+        Bits m = 0;
+        for (int sq = 0; sq < SQUARES; ++sq)
+        {
+            if (sq % N != x)
+            {
+                m |= (Bits) 1 << sq;
+            }
+        }
+        return m;
+    }
+
+    /*
+     * Shifts every stone one step in direction dir (0-7, in the order of
+     * bbShift), dropping stones that leave the board.
+     */
+    static Bits shift(Bits b, int dir)
+    {
+        constexpr Bits full = fullMask();
+        constexpr Bits not_first = notColumn(0);
+        constexpr Bits not_last = notColumn(N - 1);
+        switch (dir)
+        {
+            case 0: return (b << 1) & not_first & full;
+            case 1: return (b >> 1) & not_last;
+            case 2: return (b << N) & full;
+            case 3: return b >> N;
+            case 4: return (b << (N + 1)) & not_first & full;
+            case 5: return (b << (N - 1)) & not_last & full;
+            case 6: return (b >> (N - 1)) & not_first;
+            default: return (b >> (N + 1)) & not_last;
+        }
+    }
+
+    /*
+     * Squares where the side owning P can play; O holds its opponent.
+     */
+    static Bits moves(Bits P, Bits O)
+    {
+        Bits empty = ~(P | O) & fullMask();
+        Bits result = 0;
+        for (int dir = 0; dir < 8; ++dir)
+        {
+            Bits x = shift(P, dir) & O;
+            for (int i = 0; i < N - 3; ++i)
+            {
+                x |= shift(x, dir) & O;
+            }
+            result |= shift(x, dir) & empty;
+        }
+        return result;
+    }
+
+    /*
+     * Stones of O that flip when the side owning P plays on sq.
+     */
+    static Bits flips(Bits P, Bits O, int sq)
+    {
+        Bits result = 0;
+        for (int dir = 0; dir < 8; ++dir)
+        {
+            Bits line = 0;
+            Bits x = shift(bit(sq), dir);
+            while (x & O)
+            {
+                line |= x;
+                x = shift(x, dir);
+            }
+            if (x & P)
+            {
+                result |= line;
+            }
+        }
+        return result;
+    }
+
+    static int count(uint64_t b)
+    {
+        return __builtin_popcountll(b);
+    }
+
+    static int count(uint128_t b)
+    {
+        return __builtin_popcountll((uint64_t) b) + __builtin_popcountll((uint64_t) (b >> 64));
+    }
+
+    // Lowest square in b, which must not be empty.
+    static int first(uint64_t b)
+    {
+        return __builtin_ctzll(b);
+    }
+
+    static int first(uint128_t b)
+    {
+        uint64_t low = (uint64_t) b;
+        return low ? __builtin_ctzll(low) : 64 + __builtin_ctzll((uint64_t) (b >> 64));
+    }
+
+    Bits stones(Side side) const
+    {
+        return (side == BLACK) ? black : white;
+    }
+
+    Bits moves(Side side) const
+    {
+        return (side == BLACK) ? moves(black, white) : moves(white, black);
+    }
+
+    bool hasMoves(Side side) const
+    {
+        return moves(side) != 0;
+    }
+
+    bool isDone() const
+    {
+        return !hasMoves(BLACK) && !hasMoves(WHITE);
+    }
+
+    bool checkMove(int sq, Side side) const
+    {
+        return (sq < 0) ? !hasMoves(side) : (moves(side) & bit(sq)) != 0;
+    }
+
+    /*
+     * Plays side on sq, which must be legal; a negative sq is a pass.
+     */
+    void doMove(int sq, Side side)
+    {
+        if (sq < 0)
+        {
+            return;
+        }
+        Bits &P = (side == BLACK) ? black : white;
+        Bits &O = (side == BLACK) ? white : black;
+        Bits f = flips(P, O, sq);
+        P |= f | bit(sq);
+        O &= ~f;
+    }
+
+    int countBlack() const
+    {
+        return count(black);
+    }
+
+    int countWhite() const
+    {
+        return count(white);
+    }
+
+    /*
+     * The board as N rows of 'b', 'w' and '.', top row first.
+     */
+    string toString() const
+    {
+        string s = "";
+        for (int y = 0; y < N; ++y)
+        {
+            for (int x = 0; x < N; ++x)
+            {
+                int sq = x + N * y;
+                s += (black & bit(sq)) ? 'b' : (white & bit(sq)) ? 'w' : '.';
+            }
+            s += '\n';
+        }
+        return s;
+    }
+};
+
+#endif
@@ -0,0 +1,365 @@
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include "board.hpp"
+#include "solver.hpp"
+using namespace std;
+
+/*
+ * Size-generic tools on BoardT, instantiated for 6x6, 8x8 and 10x10.
+ *
+ * usage: boardtool perft <size> <depth>
+ *        boardtool solve <size> [moves]
+ *        boardtool match <size> [-g games] [-a depth] [-b depth] [-e empties] [-r random]
+ *        boardtool prove <size> [-n positions] [-e empties] [-t ms]
+ *        boardtool check
+ *
+ * perft counts the positions at each depth up to depth; for 8x8 it also
+ * counts them with the engine's Board and reports any difference. solve
+ * plays out moves (written like opening_moves) and solves the rest of the
+ * game exactly, printing the score for the side to move and the best line.
+ * Along the 6x6 perfect game it checks the known result, a 16-20 win for
+ * white; from the start that takes minutes, from ten plies in seconds, which
+ * is what check does after cross-checking 8x8 perft.
+ * match plays the fixed-depth searchT at depth a against depth b, from
+ * openings of random moves, with colours alternating between games.
+ * prove benchmarks the win/loss/draw prover on positions with the given
+ * number of empties, reached by depth 2 searchT games from random openings:
+ * the share it settles within ms each and its speed, against exact solves
+ * with the same limit.
+ */
+
+// Black's final disc lead on 6x6 under perfect play, and a perfect game as
+// found by solve: every position along it has that value.
+#define SOLVED_6X6 -4
+#define PERFECT_6X6 "c2b4c5d2e4e3d1c1b1d5d6f4b3b2f3f2e2b6a4a3a5a6a1b5a2c6e5e6f1e1f5f6"
+
+// Plies of the perfect game that check plays before solving the rest.
+#define CHECK_PLIES 10
+
+static double msSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+static Side other(Side side) {
+    return (side == BLACK) ? WHITE : BLACK;
+}
+
+static long long enginePerft(Board &board, Side side, int depth) {
+    if (depth == 0) return 1;
+    if (!board.hasMoves(side)) {
+        return board.hasMoves(other(side)) ? enginePerft(board, other(side), depth - 1) : 1;
+    }
+    long long total = 0;
+    for (int i = 0; i < BOARDSIZE; ++i) {
+        for (int j = 0; j < BOARDSIZE; ++j) {
+            Move m(i, j);
+            if (!board.checkMove(&m, side)) continue;
+            board.doMove(&m, side);
+            total += enginePerft(board, other(side), depth - 1);
+            board.undoMove(&m);
+        }
+    }
+    return total;
+}
+
+template <int N>
+static int runPerft(int depth) {
+    bool ok = true;
+    for (int d = 1; d <= depth; ++d) {
+        auto start = chrono::steady_clock::now();
+        long long count = perft(BoardT<N>(), BLACK, d);
+        double ms = msSince(start);
+        cout << "perft " << d << ": " << count << " (" << ms << " ms)";
+        if (N == 8) {
+            Board board;
+            long long expected = enginePerft(board, BLACK, d);
+            if (expected != count) {
+                cout << " MISMATCH with Board: " << expected;
+                ok = false;
+            }
+        }
+        cout << endl;
+    }
+    return ok ? 0 : 1;
+}
+
+template <int N>
+static string squareName(int sq) {
+    if (sq < 0) return "pass";
+    return string(1, (char) ('a' + sq % N)) + to_string(sq / N + 1);
+}
+
+/*
+ * Replays moves from the start position, passing for whoever has no move.
+ * Returns false on an illegal move.
+ */
+template <int N>
+static bool replay(const string &moves, BoardT<N> *board, Side *side) {
+    *side = BLACK;
+    for (size_t i = 0; i + 1 < moves.length(); i += 2) {
+        if (!board->hasMoves(*side)) *side = other(*side);
+        int x = tolower(moves[i]) - 'a';
+        int y = moves[i + 1] - '1';
+        if (x < 0 || x >= N || y < 0 || y >= N || !board->checkMove(x + N * y, *side)) {
+            cerr << "illegal move " << moves.substr(i, 2) << endl;
+            return false;
+        }
+        board->doMove(x + N * y, *side);
+        *side = other(*side);
+    }
+    if (!board->hasMoves(*side)) *side = other(*side);
+    return true;
+}
+
+template <int N>
+static int runSolve(const string &moves) {
+    BoardT<N> board;
+    Side side;
+    if (!replay(moves, &board, &side)) return -1;
+
+    Solver<N> solver(22);
+    auto start = chrono::steady_clock::now();
+    int best;
+    int score = solver.solve(board, side, &best);
+    double ms = msSince(start);
+
+    // The best line, read back from the solver one position at a time.
+    string line = "";
+    BoardT<N> b = board;
+    Side s = side;
+    for (int value = score; !b.isDone(); ) {
+        int sq;
+        int v = solver.solve(b, s, &sq);
+        if (v != value) break;
+        line += squareName<N>(sq) + " ";
+        b.doMove(sq, s);
+        s = other(s);
+        if (b.hasMoves(s)) value = -value;
+        else s = other(s);
+    }
+
+    cout << ((side == BLACK) ? "Black" : "White") << " to move: " << showpos << score
+         << noshowpos << endl;
+    cout << "best line: " << line << "(" << b.countBlack() << "-" << b.countWhite() << ")" << endl;
+    cout << solver.nodes << " nodes in " << ms << " ms (" << solver.nodes / ms * 1000
+         << " nodes/s)" << endl;
+    string perfect = PERFECT_6X6;
+    int black_score = (side == BLACK) ? score : -score;
+    if (N == 6 && perfect.compare(0, moves.length(), moves) == 0 && black_score != SOLVED_6X6) {
+        cout << "MISMATCH: perfect play gives black " << SOLVED_6X6 << endl;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * The quick end-to-end test: 8x8 perft against Board, and the 6x6 solve
+ * from CHECK_PLIES into the perfect game.
+ */
+static int runCheck() {
+    int result = runPerft<8>(7);
+    result |= runSolve<6>(string(PERFECT_6X6).substr(0, 2 * CHECK_PLIES));
+    cout << (result ? "FAILED" : "ok") << endl;
+    return result;
+}
+
+/*
+ * Best square for side at depth, -1 to pass.
+ */
+template <int N>
+static int chooseMove(Solver<N> &solver, const BoardT<N> &board, Side side, int depth,
+                      int endgame) {
+    typedef typename BoardT<N>::Bits Bits;
+    Bits P = board.stones(side);
+    Bits O = board.stones(other(side));
+    Bits moves = BoardT<N>::moves(P, O);
+    int best = -1;
+    int alpha = -1000 * BoardT<N>::SQUARES - 1;
+    while (moves) {
+        int sq = BoardT<N>::first(moves);
+        moves &= moves - 1;
+        Bits f = BoardT<N>::flips(P, O, sq);
+        int value = -searchT(solver, O & ~f, P | f | BoardT<N>::bit(sq), depth - 1, endgame,
+                             -1000 * BoardT<N>::SQUARES - 1, -alpha);
+        if (best < 0 || value > alpha) {
+            alpha = value;
+            best = sq;
+        }
+    }
+    return best;
+}
+
+template <int N>
+static int runMatch(int games, int depth_a, int depth_b, int endgame, int random_moves) {
+    mt19937 rng(12345);
+    Solver<N> solver(20);
+    int wins = 0, losses = 0, draws = 0;
+    auto start = chrono::steady_clock::now();
+
+    for (int g = 0; g < games; ++g) {
+        // Each opening is played twice, once with each colour.
+        rng.seed(12345 + g / 2);
+        BoardT<N> board;
+        Side side = BLACK;
+        for (int k = 0; k < random_moves && !board.isDone(); ++k) {
+            typename BoardT<N>::Bits moves = board.moves(side);
+            if (moves) {
+                int n = uniform_int_distribution<int>(0, BoardT<N>::count(moves) - 1)(rng);
+                while (n-- > 0) moves &= moves - 1;
+                board.doMove(BoardT<N>::first(moves), side);
+            }
+            side = other(side);
+        }
+
+        bool a_black = (g % 2 == 0);
+        while (!board.isDone()) {
+            bool a_turn = (side == BLACK) == a_black;
+            board.doMove(chooseMove(solver, board, side, a_turn ? depth_a : depth_b, endgame), side);
+            side = other(side);
+        }
+
+        int result = board.countBlack() - board.countWhite();
+        if (!a_black) result = -result;
+        if (result > 0) wins++;
+        else if (result < 0) losses++;
+        else draws++;
+        cout << "game " << g + 1 << ": depth " << depth_a << " as " << (a_black ? "black" : "white")
+             << " " << showpos << result << noshowpos << endl;
+    }
+
+    cout << "depth " << depth_a << " vs depth " << depth_b << ": +" << wins << " -" << losses
+         << " =" << draws << " in " << (int) msSince(start) << " ms" << endl;
+    return 0;
+}
+
+/*
+ * A position with empties empty squares and its side to move, from a game
+ * of depth 2 searchT after random_moves random ones. Returns false if the
+ * game ended first.
+ */
+template <int N>
+static bool endgamePosition(mt19937 &rng, int empties, int random_moves, Solver<N> &solver,
+                            BoardT<N> *board, Side *side) {
+    *board = BoardT<N>();
+    *side = BLACK;
+    for (int k = 0; BoardT<N>::SQUARES - BoardT<N>::count(board->black | board->white) > empties; ++k) {
+        if (board->isDone()) return false;
+        typename BoardT<N>::Bits moves = board->moves(*side);
+        if (moves && k < random_moves) {
+            int n = uniform_int_distribution<int>(0, BoardT<N>::count(moves) - 1)(rng);
+            while (n-- > 0) moves &= moves - 1;
+            board->doMove(BoardT<N>::first(moves), *side);
+        } else if (moves) {
+            board->doMove(chooseMove(solver, *board, *side, 2, 0), *side);
+        }
+        *side = other(*side);
+    }
+    if (!board->hasMoves(*side)) *side = other(*side);
+    return !board->isDone();
+}
+
+template <int N>
+static int runProve(int positions, int empties, int ms) {
+    mt19937 rng(12345);
+    Solver<N> solver(22);
+    int found = 0;
+    int proved = 0, wins = 0, draws = 0, losses = 0, solved = 0;
+    long long prove_nodes = 0, solve_nodes = 0;
+    double prove_ms = 0, solve_ms = 0;
+
+    while (found < positions) {
+        BoardT<N> board;
+        Side side;
+        if (!endgamePosition(rng, empties, 10, solver, &board, &side)) continue;
+        ++found;
+
+        // Each search starts with an empty table, as the first search of
+        // an endgame would.
+        Solver<N> prover(22);
+        prover.setDeadline(ms);
+        auto start = chrono::steady_clock::now();
+        int result = prover.prove(board, side);
+        prove_ms += msSince(start);
+        prove_nodes += prover.nodes;
+        if (!prover.aborted) {
+            ++proved;
+            if (result > 0) ++wins;
+            else if (result < 0) ++losses;
+            else ++draws;
+        }
+
+        Solver<N> exact(22);
+        exact.setDeadline(ms);
+        start = chrono::steady_clock::now();
+        exact.solve(board, side);
+        solve_ms += msSince(start);
+        solve_nodes += exact.nodes;
+        if (!exact.aborted) ++solved;
+    }
+
+    cout << positions << " positions with " << empties << " empties, " << ms << " ms each" << endl;
+    cout << "prover: " << proved << " proved (" << 100.0 * proved / positions << "%: +" << wins
+         << " =" << draws << " -" << losses << "), " << positions / prove_ms * 1000
+         << " positions/s, " << prove_nodes / prove_ms * 1000 << " nodes/s" << endl;
+    cout << "exact:  " << solved << " solved (" << 100.0 * solved / positions << "%), "
+         << positions / solve_ms * 1000 << " positions/s, " << solve_nodes / solve_ms * 1000
+         << " nodes/s" << endl;
+    return 0;
+}
+
+static void usage(const char *name) {
+    cerr << "usage: " << name << " perft <size> <depth>" << endl;
+    cerr << "       " << name << " solve <size> [moves]" << endl;
+    cerr << "       " << name << " match <size> [-g games] [-a depth] [-b depth] [-e empties]"
+         << " [-r random]" << endl;
+    cerr << "       " << name << " prove <size> [-n positions] [-e empties] [-t ms]" << endl;
+    cerr << "       " << name << " check" << endl;
+    cerr << "sizes: 6, 8, 10" << endl;
+    exit(-1);
+}
+
+template <int N>
+static int run(int argc, char *argv[]) {
+    string command = argv[1];
+    if (command == "perft" && argc == 4) return runPerft<N>(atoi(argv[3]));
+    if (command == "solve" && argc <= 4) return runSolve<N>((argc == 4) ? argv[3] : "");
+    if (command == "match") {
+        int games = 2, depth_a = 4, depth_b = 2, endgame = 12, random_moves = 4;
+        for (int i = 3; i < argc; ++i) {
+            if (!strcmp(argv[i], "-g") && i + 1 < argc) games = atoi(argv[++i]);
+            else if (!strcmp(argv[i], "-a") && i + 1 < argc) depth_a = atoi(argv[++i]);
+            else if (!strcmp(argv[i], "-b") && i + 1 < argc) depth_b = atoi(argv[++i]);
+            else if (!strcmp(argv[i], "-e") && i + 1 < argc) endgame = atoi(argv[++i]);
+            else if (!strcmp(argv[i], "-r") && i + 1 < argc) random_moves = atoi(argv[++i]);
+            else usage(argv[0]);
+        }
+        return runMatch<N>(games, max(1, depth_a), max(1, depth_b), endgame, random_moves);
+    }
+    if (command == "prove") {
+        int positions = 20, empties = 22, ms = 5000;
+        for (int i = 3; i < argc; ++i) {
+            if (!strcmp(argv[i], "-n") && i + 1 < argc) positions = atoi(argv[++i]);
+            else if (!strcmp(argv[i], "-e") && i + 1 < argc) empties = atoi(argv[++i]);
+            else if (!strcmp(argv[i], "-t") && i + 1 < argc) ms = atoi(argv[++i]);
+            else usage(argv[0]);
+        }
+        return runProve<N>(max(1, positions), empties, ms);
+    }
+    usage(argv[0]);
+    return -1;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc == 2 && !strcmp(argv[1], "check")) return runCheck();
+    if (argc < 3) usage(argv[0]);
+    switch (atoi(argv[2])) {
+        case 6: return run<6>(argc, argv);
+        case 8: return run<8>(argc, argv);
+        case 10: return run<10>(argc, argv);
+        default: usage(argv[0]);
+    }
+    return -1;
+}
@@ -0,0 +1,348 @@
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include "player.hpp"
+#include "memory.hpp"
+#include "threadpool.hpp"
+using namespace std;
+
+/*
+ * Builds an opening book by best-first expansion. Every round picks the most
+ * promising unexpanded lines of the book, scores all their children with the
+ * engine's alpha-beta search in parallel and backs the scores up the book
+ * by negamax. A line's priority is the score it gives away against the best
+ * move at each of its positions, for either side, plus ply_cost per move, so
+ * the book grows deepest along the main lines and spreads out where
+ * alternatives are close.
+ *
+ * usage: bookbuilder [-d depth] [-j threads] [-n nodes] [-t minutes]
+ *                    [-c ply_cost] [-b batch] checkpoint book
+ *
+ * The checkpoint is rewritten after every round and picked up again on the
+ * next run, so a build can be stopped and resumed. book is written in the
+ * opening_moves format: one line per book leaf, with the lines under every
+ * position ordered best move first, which is the line Player::doMove plays.
+ */
+
+// Scores for finished games, per disc, to rank them above any evaluation.
+#define BOOK_WIN_SCALE 100000.0
+
+struct BookNode {
+    string moves;
+    int parent;
+    vector<int> children;
+    // Side to move. A side without a move has already passed.
+    Side mover;
+    uint64_t black, white;
+    // Nobody can move.
+    bool terminal;
+    bool expanded;
+    // Search score of the position for mover, and its negamax value: the
+    // score until the node is expanded.
+    double score;
+    double value;
+};
+
+static vector<BookNode> book;
+static map<string, int> book_index;
+
+static Side other(Side side) {
+    return (side == BLACK) ? WHITE : BLACK;
+}
+
+/*
+ * Adds the position of board after moves, with to_move next, as a child of
+ * parent, or as the root if parent is -1.
+ */
+static int addNode(int parent, const string &moves, Board &board, Side to_move) {
+    BookNode n;
+    n.moves = moves;
+    n.parent = parent;
+    n.black = board.getBlack();
+    n.white = board.getWhite();
+    n.mover = board.hasMoves(to_move) ? to_move : other(to_move);
+    n.terminal = !board.hasMoves(n.mover);
+    n.expanded = false;
+    n.score = 0;
+    if (n.terminal) {
+        int diff = board.count(n.mover) - board.count(other(n.mover));
+        n.score = diff * BOOK_WIN_SCALE;
+    }
+    n.value = n.score;
+
+    book.push_back(n);
+    int id = book.size() - 1;
+    book_index[moves] = id;
+    if (parent >= 0) book[parent].children.push_back(id);
+    return id;
+}
+
+static Board nodeBoard(const BookNode &n) {
+    Board board;
+    board.setBitboards(n.black, n.white);
+    return board;
+}
+
+/*
+ * Value of child c from the point of view of the side to move at n.
+ */
+static double childValue(int n, int c) {
+    return (book[c].mover == book[n].mover) ? book[c].value : -book[c].value;
+}
+
+static void propagate(int n) {
+    if (!book[n].expanded || book[n].children.empty()) {
+        book[n].value = book[n].score;
+        return;
+    }
+    double best = -HUGE_VAL;
+    for (int c : book[n].children) {
+        propagate(c);
+        best = max(best, childValue(n, c));
+    }
+    book[n].value = best;
+}
+
+/*
+ * Adds the unexpanded leaves under n with their priorities to leaves.
+ */
+static void collectLeaves(int n, double priority, double ply_cost,
+                          vector<pair<double, int>> &leaves) {
+    if (book[n].terminal) return;
+    if (!book[n].expanded) {
+        leaves.push_back(make_pair(priority, n));
+        return;
+    }
+    for (int c : book[n].children) {
+        collectLeaves(c, priority + book[n].value - childValue(n, c) + ply_cost, ply_cost, leaves);
+    }
+}
+
+/*
+ * Gives each leaf its children, returning the new nodes to be searched.
+ */
+static vector<int> expand(const vector<int> &leaves) {
+    vector<int> added;
+    for (int leaf : leaves) {
+        for (int i = 0; i < BOARDSIZE; ++i) {
+            for (int j = 0; j < BOARDSIZE; ++j) {
+                Board board = nodeBoard(book[leaf]);
+                Move m(i, j);
+                if (!board.checkMove(&m, book[leaf].mover)) continue;
+                board.doMove(&m, book[leaf].mover);
+                char name[] = {(char) ('a' + i), (char) ('1' + j), '\0'};
+                int c = addNode(leaf, book[leaf].moves + name, board, other(book[leaf].mover));
+                if (!book[c].terminal) added.push_back(c);
+            }
+        }
+        book[leaf].expanded = true;
+    }
+    return added;
+}
+
+// Transposition tables of the search threads, freed when the build ends.
+static vector<TranspositionTable *> search_tables;
+static mutex search_tables_lock;
+
+/*
+ * Scores the given nodes with the engine's search, in parallel. Both sides
+ * evaluate with the same symmetric heuristic, so a node's score is one scale
+ * negated for the side to move and the nodes can be compared by negamax.
+ * Each thread keeps a transposition table per side for the whole run, since
+ * scores in the table are from the searching side's point of view.
+ */
+static void search(const vector<int> &nodes, int depth, ThreadPool &pool) {
+    size_t tt_bytes = MemoryBudget::instance().share(MEMORY_SHARE_TT) / (2 * pool.size());
+    pool.parallelFor(nodes.size(), [&](size_t k) {
+        static thread_local TranspositionTable *tables[2] = {nullptr, nullptr};
+        BookNode &n = book[nodes[k]];
+        if (tables[n.mover] == nullptr) {
+            tables[n.mover] = new TranspositionTable(tt_bytes);
+            lock_guard<mutex> lock(search_tables_lock);
+            search_tables.push_back(tables[n.mover]);
+        }
+
+        Player player(n.mover);
+        player.symmetricEval = true;
+        player.board.setBitboards(n.black, n.white);
+        player.tt = tables[n.mover];
+        vector<PVLine> lines = player.searchMultiPV(1, depth);
+        n.score = lines.empty() ? 0 : lines[0].score;
+        player.tt = nullptr;
+    });
+}
+
+static bool saveCheckpoint(const string &file) {
+    string tmp = file + ".tmp";
+    FILE *f = fopen(tmp.c_str(), "w");
+    if (f == nullptr) {
+        perror(tmp.c_str());
+        return false;
+    }
+    for (uint i = 0; i < book.size(); ++i) {
+        fprintf(f, "%s %.17g %d\n", book[i].moves.empty() ? "-" : book[i].moves.c_str(),
+                book[i].score, book[i].expanded ? 1 : 0);
+    }
+    if (fclose(f) != 0 || rename(tmp.c_str(), file.c_str()) != 0) {
+        perror(file.c_str());
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Rebuilds the book from a checkpoint. Parents come before their children
+ * in the file, so every node is its parent's position plus one move.
+ */
+static bool loadCheckpoint(const string &file) {
+    ifstream in(file);
+    if (!in) return false;
+
+    string line;
+    while (getline(in, line)) {
+        istringstream ss(line);
+        string moves;
+        double score;
+        int expanded;
+        if (!(ss >> moves >> score >> expanded)) continue;
+        if (moves == "-") moves = "";
+
+        if (moves.empty()) {
+            Board board;
+            addNode(-1, "", board, BLACK);
+        } else {
+            auto parent = book_index.find(moves.substr(0, moves.length() - 2));
+            if (parent == book_index.end()) {
+                cerr << file << ": " << moves << " has no parent" << endl;
+                return false;
+            }
+            int p = parent->second;
+            Board board = nodeBoard(book[p]);
+            Move m(moves[moves.length() - 2] - 'a', moves[moves.length() - 1] - '1');
+            board.doMove(&m, book[p].mover);
+            addNode(p, moves, board, other(book[p].mover));
+        }
+        book.back().score = score;
+        book.back().expanded = (expanded != 0);
+    }
+    propagate(0);
+    return !book.empty();
+}
+
+static void writeLines(int n, ofstream &out) {
+    if (!book[n].expanded || book[n].children.empty()) {
+        if (!book[n].moves.empty()) out << book[n].moves << "\n";
+        return;
+    }
+    vector<int> children = book[n].children;
+    stable_sort(children.begin(), children.end(), [n](int a, int b) {
+        return childValue(n, a) > childValue(n, b);
+    });
+    for (int c : children) writeLines(c, out);
+}
+
+static bool saveBook(const string &file) {
+    ofstream out(file + ".tmp");
+    writeLines(0, out);
+    out.close();
+    if (!out || rename((file + ".tmp").c_str(), file.c_str()) != 0) {
+        perror(file.c_str());
+        return false;
+    }
+    return true;
+}
+
+/*
+ * The book's main line: the best move from each position down to a leaf.
+ */
+static string mainLine() {
+    int n = 0;
+    while (book[n].expanded && !book[n].children.empty()) {
+        int best = book[n].children[0];
+        for (int c : book[n].children) {
+            if (childValue(n, c) > childValue(n, best)) best = c;
+        }
+        n = best;
+    }
+    return book[n].moves;
+}
+
+int main(int argc, char *argv[]) {
+    int depth = 8;
+    int threads = max(1, (int) thread::hardware_concurrency());
+    int max_nodes = 1000;
+    double minutes = 0;
+    double ply_cost = 300;
+    int batch = 0;
+    vector<string> files;
+    bool bad_option = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-d") && i + 1 < argc) depth = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-j") && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc) max_nodes = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc) minutes = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-c") && i + 1 < argc) ply_cost = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-b") && i + 1 < argc) batch = atoi(argv[++i]);
+        else if (argv[i][0] != '-') files.push_back(argv[i]);
+        else bad_option = true;
+    }
+    if (files.size() != 2 || bad_option) {
+        cerr << "usage: " << argv[0] << " [-d depth] [-j threads] [-n nodes] [-t minutes]"
+             << " [-c ply_cost] [-b batch] checkpoint book" << endl;
+        exit(-1);
+    }
+    // Root moves are searched with an even depth left, so that the opponent
+    // is to move at the first ply of getABScore.
+    depth += depth % 2;
+    if (batch <= 0) batch = threads;
+
+    if (loadCheckpoint(files[0])) {
+        cerr << "resuming from " << files[0] << " with " << book.size() << " positions" << endl;
+    } else {
+        book.clear();
+        book_index.clear();
+        Board board;
+        addNode(-1, "", board, BLACK);
+    }
+
+    ThreadPool pool(threads);
+    auto start = chrono::steady_clock::now();
+    long searched = 0;
+
+    while ((int) book.size() < max_nodes) {
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (minutes > 0 && elapsed > minutes * 60) break;
+
+        vector<pair<double, int>> leaves;
+        collectLeaves(0, 0, ply_cost, leaves);
+        if (leaves.empty()) break;
+        int count = min((int) leaves.size(), batch);
+        partial_sort(leaves.begin(), leaves.begin() + count, leaves.end());
+
+        vector<int> chosen;
+        for (int k = 0; k < count; ++k) chosen.push_back(leaves[k].second);
+        vector<int> added = expand(chosen);
+        search(added, depth, pool);
+        searched += added.size();
+        propagate(0);
+
+        if (!saveCheckpoint(files[0]) || !saveBook(files[1])) exit(-1);
+
+        elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cerr << book.size() << " positions, " << searched / elapsed << " searches/s, value "
+             << book[0].value << ", main line " << mainLine() << endl;
+    }
+    for (TranspositionTable *table : search_tables) delete table;
+    search_tables.clear();
+
+    if (!saveCheckpoint(files[0]) || !saveBook(files[1])) exit(-1);
+    return 0;
+}
@@ -0,0 +1,65 @@
+#ifndef __CASSIO_H__
+#define __CASSIO_H__
+
+/*
+ * C interface to the Cassio engine, built as libcassio.so. Positions are two
+ * 64-bit boards with bit x + 8 * y set for every black or white stone, and
+ * squares are numbered the same way.
+ *
+ * Batch calls read the caller's arrays in place and write results straight
+ * into the caller's output arrays; the n positions are spread over the
+ * engine's thread pool. An engine may be used from several threads at once.
+ *
+ *     cassio_engine *engine = cassio_engine_new(6, 0);
+ *     cassio_search_batch(engine, black, white, sides, n, moves, scores);
+ *     cassio_engine_free(engine);
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CASSIO_API __attribute__((visibility("default")))
+
+#define CASSIO_WHITE 0
+#define CASSIO_BLACK 1
+#define CASSIO_PASS (-1)
+
+typedef struct cassio_engine cassio_engine;
+
+/*
+ * Creates an engine searching to the given depth on the given number of
+ * threads (0 for one per core). Returns NULL on failure.
+ */
+CASSIO_API cassio_engine *cassio_engine_new(int depth, int threads);
+CASSIO_API void cassio_engine_free(cassio_engine *engine);
+
+/*
+ * Static evaluation of n positions from the point of view of sides[i], the
+ * side to move. Returns the number of invalid positions (stones on the same
+ * square for both colours, or a bad side), whose score is set to NaN, or -1
+ * if an argument is NULL.
+ */
+CASSIO_API int cassio_evaluate_batch(cassio_engine *engine, const uint64_t *black,
+                                     const uint64_t *white, const int *sides, size_t n,
+                                     double *scores);
+
+/*
+ * Alpha-beta search of n positions for sides[i]. moves[i] receives the best
+ * square or CASSIO_PASS and scores[i] its score (NaN for an invalid
+ * position). Returns as cassio_evaluate_batch.
+ */
+CASSIO_API int cassio_search_batch(cassio_engine *engine, const uint64_t *black,
+                                   const uint64_t *white, const int *sides, size_t n,
+                                   int *moves, double *scores);
+
+CASSIO_API const char *cassio_version(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
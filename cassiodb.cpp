@@ -0,0 +1,95 @@
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include "board.hpp"
+#include "gamedb.hpp"
+using namespace std;
+
+/*
+ * Command line front end for the game database.
+ *
+ * usage: cassiodb import <db> <games.txt> [threads]
+ *        cassiodb query <db> <moves>
+ *        cassiodb query <db> -b <board> <Black|White>
+ *
+ * Games and move queries use the made_moves form ("f5d6c3..."). A board is
+ * 64 characters of 'b', 'w' and '.' in Board::setBoard order, followed by
+ * the side to move.
+ */
+int main(int argc, char *argv[]) {
+    if (argc >= 4 && !strcmp(argv[1], "import")) {
+        int threads = (argc >= 5) ? atoi(argv[4]) : max(1, (int) thread::hardware_concurrency());
+        auto start = chrono::steady_clock::now();
+        bool ok = GameDB::import(argv[2], argv[3], threads);
+        cerr << "import took " << chrono::duration<double, milli>(
+            chrono::steady_clock::now() - start).count() << " ms" << endl;
+        return ok ? 0 : 1;
+    }
+
+    if (argc < 4 || strcmp(argv[1], "query")) {
+        cerr << "usage: " << argv[0] << " import <db> <games.txt> [threads]" << endl;
+        cerr << "       " << argv[0] << " query <db> <moves>" << endl;
+        cerr << "       " << argv[0] << " query <db> -b <board> <Black|White>" << endl;
+        exit(-1);
+    }
+
+    uint64_t black, white;
+    Side side;
+    if (!strcmp(argv[3], "-b")) {
+        if (argc < 6 || strlen(argv[4]) != 64) {
+            cerr << "board must be 64 characters" << endl;
+            exit(-1);
+        }
+        Board board;
+        board.setBoard(argv[4]);
+        black = board.getBlack();
+        white = board.getWhite();
+        side = strcmp(argv[5], "Black") ? WHITE : BLACK;
+    } else {
+        Board board;
+        side = BLACK;
+        string moves = argv[3];
+        for (size_t i = 0; i + 1 < moves.length(); i += 2) {
+            if (!board.hasMoves(side)) side = (side == BLACK) ? WHITE : BLACK;
+            Move m(tolower(moves[i]) - 'a', moves[i + 1] - '1');
+            if (m.x < 0 || m.x >= BOARDSIZE || m.y < 0 || m.y >= BOARDSIZE ||
+                !board.checkMove(&m, side)) {
+                cerr << "illegal move " << moves.substr(i, 2) << endl;
+                exit(-1);
+            }
+            board.doMove(&m, side);
+            side = (side == BLACK) ? WHITE : BLACK;
+        }
+        black = board.getBlack();
+        white = board.getWhite();
+    }
+
+    GameDB db;
+    if (!db.open(argv[2])) {
+        return 1;
+    }
+
+    auto start = chrono::steady_clock::now();
+    vector<GameDBMatch> matches = db.find(black, white, side);
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    int black_wins = 0, white_wins = 0, draws = 0;
+    for (uint i = 0; i < matches.size(); ++i) {
+        if (matches[i].result > 0) black_wins++;
+        else if (matches[i].result < 0) white_wins++;
+        else draws++;
+        if (i < 20) {
+            cout << "  " << GameDB::moveString(matches[i].moves) << " "
+                 << (matches[i].result > 0 ? "+" : "") << matches[i].result
+                 << " (ply " << matches[i].ply << ")" << endl;
+        }
+    }
+    if (matches.size() > 20) {
+        cout << "  ... " << matches.size() - 20 << " more" << endl;
+    }
+    cout << matches.size() << " games: black won " << black_wins << ", white won "
+         << white_wins << ", " << draws << " drawn (" << ms << " ms)" << endl;
+    return 0;
+}
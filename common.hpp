@@ -1,6 +1,7 @@
 #ifndef __COMMON_H__
 #define __COMMON_H__
 #include <algorithm>
+#include <iterator>
 
 #define BOARDSIZE 8
 #define AVGMOVES 25.0
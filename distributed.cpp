@@ -0,0 +1,365 @@
+#include "distributed.hpp"
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+RemoteWorker::RemoteWorker(string host, int port)
+{
+    this->host = host;
+    this->port = port;
+    jobs_done = 0;
+    fd = -1;
+}
+
+RemoteWorker::~RemoteWorker()
+{
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+/*
+ * Connects to the worker, retrying every 100 ms so that freshly spawned
+ * workers have time to start listening. Returns false if every attempt fails.
+ */
+bool RemoteWorker::connect(int retries)
+{
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    if (getaddrinfo(host.c_str(), to_string(port).c_str(), &hints, &res) != 0)
+    {
+        cerr << "worker " << host << ":" << port << ": unknown host" << endl;
+        return false;
+    }
+
+    for (int i = 0; i <= retries; ++i)
+    {
+        fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+        if (fd >= 0 && ::connect(fd, res->ai_addr, res->ai_addrlen) == 0)
+        {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            freeaddrinfo(res);
+            return true;
+        }
+        if (fd >= 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+        this_thread::sleep_for(chrono::milliseconds(100));
+    }
+
+    freeaddrinfo(res);
+    cerr << "worker " << host << ":" << port << ": connection refused" << endl;
+    return false;
+}
+
+bool RemoteWorker::sendLine(const string &line)
+{
+    string out = line + "\n";
+    size_t sent = 0;
+    while (sent < out.size())
+    {
+        ssize_t n = send(fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0)
+        {
+            return false;
+        }
+        sent += n;
+    }
+    return true;
+}
+
+bool RemoteWorker::readLine(string &line)
+{
+    size_t pos;
+    while ((pos = buffer.find('\n')) == string::npos)
+    {
+        char chunk[256];
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0)
+        {
+            return false;
+        }
+        buffer.append(chunk, n);
+    }
+    line = buffer.substr(0, pos);
+    buffer.erase(0, pos + 1);
+    return true;
+}
+
+/*
+ * Asks the worker to score root move m for side on the given board. Returns
+ * false if the worker has gone away, in which case the move has to be given
+ * to someone else.
+ */
+bool RemoteWorker::search(Board &board, Side side, Move *m, int d,
+                          double alpha, double beta, double *value)
+{
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    char request[160];
+    snprintf(request, sizeof(request), "SEARCH %llx %llx %d %d %d %d %.17g %.17g",
+             (unsigned long long) board.getBlack(),
+             (unsigned long long) board.getWhite(),
+             side == BLACK ? 1 : 0, m->getX(), m->getY(), d, alpha, beta);
+
+    string reply;
+    if (!sendLine(request) || !readLine(reply) || reply.compare(0, 6, "SCORE ") != 0)
+    {
+        close(fd);
+        fd = -1;
+        return false;
+    }
+
+    *value = strtod(reply.c_str() + 6, nullptr);
+    ++jobs_done;
+    return true;
+}
+
+void RemoteWorker::quit()
+{
+    if (fd >= 0)
+    {
+        sendLine("QUIT");
+        close(fd);
+        fd = -1;
+    }
+}
+
+/*
+ * Answers SEARCH requests from one coordinator connection until it sends
+ * QUIT or hangs up.
+ */
+static void serveConnection(int conn)
+{
+    string buffer;
+    char chunk[256];
+
+    while (true)
+    {
+        size_t pos;
+        while ((pos = buffer.find('\n')) == string::npos)
+        {
+            ssize_t n = recv(conn, chunk, sizeof(chunk), 0);
+            if (n <= 0)
+            {
+                return;
+            }
+            buffer.append(chunk, n);
+        }
+        string line = buffer.substr(0, pos);
+        buffer.erase(0, pos + 1);
+
+        istringstream in(line);
+        string command;
+        in >> command;
+        if (command == "QUIT")
+        {
+            return;
+        }
+
+        uint64_t black_bits, white_bits;
+        int side, x, y, d;
+        double alpha, beta;
+        in >> hex >> black_bits >> white_bits >> dec >> side >> x >> y >> d >> alpha >> beta;
+        if (command != "SEARCH" || in.fail())
+        {
+            cerr << "worker: bad request: " << line << endl;
+            return;
+        }
+
+        Player player(side == 1 ? BLACK : WHITE);
+        player.board.setBitboards(black_bits, white_bits);
+        Move m(x, y);
+        double value = player.searchRootMove(&m, d, alpha, beta);
+
+        char reply[64];
+        int len = snprintf(reply, sizeof(reply), "SCORE %.17g\n", value);
+        if (send(conn, reply, len, MSG_NOSIGNAL) != len)
+        {
+            return;
+        }
+    }
+}
+
+/*
+ * Runs a search worker listening on TCP port of the local address host.
+ * The protocol has no authentication, so callers bind to the loopback
+ * address unless remote coordinators are wanted. Coordinators are served
+ * one at a time; the function only returns on a socket error.
+ */
+int runWorker(const string &host, int port)
+{
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host.c_str(), to_string(port).c_str(), &hints, &res) != 0)
+    {
+        cerr << "worker: unknown address " << host << endl;
+        return -1;
+    }
+
+    int server = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (server < 0)
+    {
+        perror("socket");
+        freeaddrinfo(res);
+        return -1;
+    }
+
+    int one = 1;
+    setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    if (bind(server, res->ai_addr, res->ai_addrlen) < 0 || listen(server, 4) < 0)
+    {
+        perror("bind");
+        freeaddrinfo(res);
+        close(server);
+        return -1;
+    }
+    freeaddrinfo(res);
+
+    cerr << "worker listening on " << host << ":" << port << endl;
+
+    while (true)
+    {
+        int conn = accept(server, nullptr, nullptr);
+        if (conn < 0)
+        {
+            perror("accept");
+            close(server);
+            return -1;
+        }
+        setsockopt(conn, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        serveConnection(conn);
+        close(conn);
+    }
+}
+
+/*
+ * Splits the root of an alpha-beta search across remote workers. Root moves
+ * go into a shared queue that every worker pulls from as soon as it is free,
+ * so workers that finish early simply take more of the remaining moves. Each
+ * move is searched with the best score found so far as its alpha bound. A
+ * move whose worker fails is put back on the queue for the others, and if
+ * no worker is left it is searched locally.
+ *
+ * Returns the best move (nullptr if there are no legal moves) and stores
+ * its score in best_value.
+ */
+Move *doDistributedMove(Board &board, Side side, int depth,
+                        vector<RemoteWorker *> &workers, double *best_value)
+{
+    vector<Move *> queue;
+    for (int i = BOARDSIZE - 1; i >= 0; --i)
+    {
+        for (int j = BOARDSIZE - 1; j >= 0; --j)
+        {
+            Move *m = new Move(i, j);
+            if (board.checkMove(m, side))
+            {
+                queue.push_back(m);
+            }
+            else
+            {
+                delete m;
+            }
+        }
+    }
+
+    mutex lock;
+    Move *best_move = nullptr;
+    *best_value = LOW;
+
+    vector<thread> threads;
+    for (uint w = 0; w < workers.size(); ++w)
+    {
+        threads.push_back(thread([&, w]() {
+            while (true)
+            {
+                Move *m;
+                double alpha;
+                {
+                    lock_guard<mutex> guard(lock);
+                    if (queue.empty())
+                    {
+                        return;
+                    }
+                    m = queue.back();
+                    queue.pop_back();
+                    alpha = *best_value;
+                }
+
+                double value;
+                if (!workers[w]->search(board, side, m, depth, alpha, HIGH, &value))
+                {
+                    lock_guard<mutex> guard(lock);
+                    cerr << "worker " << workers[w]->host << ":" << workers[w]->port
+                         << " failed, requeueing move" << endl;
+                    queue.push_back(m);
+                    return;
+                }
+
+                lock_guard<mutex> guard(lock);
+                if (value > *best_value)
+                {
+                    *best_value = value;
+                    delete best_move;
+                    best_move = m;
+                }
+                else
+                {
+                    delete m;
+                }
+            }
+        }));
+    }
+
+    for (uint i = 0; i < threads.size(); ++i)
+    {
+        threads[i].join();
+    }
+
+    // Moves requeued after the last worker had failed are searched here, so
+    // that the best move is still chosen from all of them.
+    if (!queue.empty())
+    {
+        cerr << "no workers left, searching " << queue.size() << " moves locally" << endl;
+        Player player(side);
+        player.board = board;
+        for (uint i = 0; i < queue.size(); ++i)
+        {
+            double value = player.searchRootMove(queue[i], depth, *best_value, HIGH);
+            if (value > *best_value)
+            {
+                *best_value = value;
+                delete best_move;
+                best_move = queue[i];
+            }
+            else
+            {
+                delete queue[i];
+            }
+        }
+    }
+
+    return best_move;
+}
@@ -0,0 +1,59 @@
+#ifndef __DISTRIBUTED_H__
+#define __DISTRIBUTED_H__
+
+#include "common.hpp"
+#include "board.hpp"
+#include "player.hpp"
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*
+ * Line based protocol spoken between a coordinator and its workers:
+ *
+ *   SEARCH <black hex> <white hex> <side> <x> <y> <depth> <alpha> <beta>
+ *       -> SCORE <value>
+ *   QUIT
+ *       -> connection closed
+ *
+ * <side> is 0 for WHITE and 1 for BLACK; (x, y) is the root move to play
+ * for that side before searching the reply tree to <depth>.
+ */
+
+/*
+ * Connection from the coordinator to one worker process.
+ */
+class RemoteWorker {
+public:
+    RemoteWorker(string host, int port);
+    ~RemoteWorker();
+
+    bool connect(int retries);
+    bool search(Board &board, Side side, Move *m, int d,
+                double alpha, double beta, double *value);
+    void quit();
+
+    string host;
+    int port;
+
+    // Number of root moves this worker has scored.
+    int jobs_done;
+
+private:
+    bool sendLine(const string &line);
+    bool readLine(string &line);
+
+    int fd;
+    string buffer;
+};
+
+// Address workers listen on unless told otherwise.
+#define WORKER_DEFAULT_HOST "127.0.0.1"
+
+int runWorker(const string &host, int port);
+
+Move *doDistributedMove(Board &board, Side side, int depth,
+                        vector<RemoteWorker *> &workers, double *best_value);
+
+#endif
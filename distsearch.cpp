@@ -0,0 +1,146 @@
+#include <iostream>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "distributed.hpp"
+using namespace std;
+
+/*
+ * Coordinator for the distributed root-split search. Scores the root of a
+ * position once in this process and once split across worker processes
+ * (started with "Cassio --worker <port>", which only listens on 127.0.0.1,
+ * or "Cassio --worker <host>:<port>" to listen on that address for remote
+ * coordinators), checks that both agree and prints the speedup.
+ *
+ * usage: distsearch [-d depth] [-s Black|White] [-b board] [-n spawn]
+ *                   [-p base_port] [-e engine] [host:port ...]
+ *
+ * -b takes 64 characters of 'b', 'w' and '.' in the same order as
+ * Board::setBoard. -n starts that many local workers on consecutive ports.
+ */
+int main(int argc, char *argv[]) {
+    int depth = 6;
+    Side side = BLACK;
+    int spawn = 0;
+    int base_port = 7700;
+    string engine = "./Cassio";
+    string board_str = "";
+    vector<string> addresses;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "-d" && i + 1 < argc) depth = atoi(argv[++i]);
+        else if (arg == "-s" && i + 1 < argc) side = strcmp(argv[++i], "Black") ? WHITE : BLACK;
+        else if (arg == "-b" && i + 1 < argc) board_str = argv[++i];
+        else if (arg == "-n" && i + 1 < argc) spawn = atoi(argv[++i]);
+        else if (arg == "-p" && i + 1 < argc) base_port = atoi(argv[++i]);
+        else if (arg == "-e" && i + 1 < argc) engine = argv[++i];
+        else if (arg[0] != '-') addresses.push_back(arg);
+        else {
+            cerr << "usage: " << argv[0] << " [-d depth] [-s Black|White] [-b board]"
+                 << " [-n spawn] [-p base_port] [-e engine] [host:port ...]" << endl;
+            exit(-1);
+        }
+    }
+
+    Board board;
+    if (board_str.length() == 64) {
+        char data[64];
+        for (int i = 0; i < 64; ++i) data[i] = board_str[i];
+        board.setBoard(data);
+    } else if (board_str != "") {
+        cerr << "board must be 64 characters" << endl;
+        exit(-1);
+    }
+
+    // Start local workers if asked to.
+    vector<pid_t> children;
+    for (int i = 0; i < spawn; ++i) {
+        int port = base_port + i;
+        pid_t pid = fork();
+        if (pid == 0) {
+            string port_str = to_string(port);
+            execl(engine.c_str(), engine.c_str(), "--worker", port_str.c_str(), (char *) nullptr);
+            perror("execl");
+            _exit(1);
+        }
+        children.push_back(pid);
+        addresses.push_back("127.0.0.1:" + to_string(port));
+    }
+
+    if (addresses.empty()) {
+        cerr << "no workers given" << endl;
+        exit(-1);
+    }
+
+    vector<RemoteWorker *> workers;
+    for (uint i = 0; i < addresses.size(); ++i) {
+        size_t colon = addresses[i].rfind(':');
+        if (colon == string::npos) {
+            cerr << "bad worker address " << addresses[i] << endl;
+            continue;
+        }
+        RemoteWorker *worker = new RemoteWorker(addresses[i].substr(0, colon),
+                                                atoi(addresses[i].c_str() + colon + 1));
+        if (worker->connect(50)) {
+            workers.push_back(worker);
+        } else {
+            delete worker;
+        }
+    }
+
+    // Single process reference search.
+    Player player(side);
+    player.board = board;
+    player.depth = depth;
+    auto start = chrono::steady_clock::now();
+    Move *local_move = player.doABMinimaxMove();
+    double local_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    double local_value = LOW;
+    if (local_move != nullptr) {
+        local_value = player.searchRootMove(local_move, depth, LOW, HIGH);
+    }
+
+    start = chrono::steady_clock::now();
+    double dist_value;
+    Move *dist_move = doDistributedMove(board, side, depth, workers, &dist_value);
+    double dist_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    cout << "depth " << depth << ", " << workers.size() << " workers" << endl;
+    cout << "single process: ";
+    if (local_move != nullptr) cout << "(" << local_move->x << ", " << local_move->y << ")";
+    else cout << "PASS";
+    cout << " score " << local_value << " in " << local_ms << " ms" << endl;
+    cout << "distributed:    ";
+    if (dist_move != nullptr) cout << "(" << dist_move->x << ", " << dist_move->y << ")";
+    else cout << "PASS";
+    cout << " score " << dist_value << " in " << dist_ms << " ms" << endl;
+    for (uint i = 0; i < workers.size(); ++i) {
+        cout << "  " << workers[i]->host << ":" << workers[i]->port << " scored "
+             << workers[i]->jobs_done << " root moves" << endl;
+    }
+    cout << "speedup: " << local_ms / dist_ms << "x" << endl;
+
+    bool agree = (local_move == nullptr && dist_move == nullptr) ||
+                 (local_move != nullptr && dist_move != nullptr && local_value == dist_value);
+    if (!agree) {
+        cout << "MISMATCH between single process and distributed scores" << endl;
+    }
+
+    for (uint i = 0; i < workers.size(); ++i) {
+        workers[i]->quit();
+        delete workers[i];
+    }
+    for (uint i = 0; i < children.size(); ++i) {
+        kill(children[i], SIGTERM);
+        waitpid(children[i], nullptr, 0);
+    }
+
+    delete local_move;
+    delete dist_move;
+    return agree ? 0 : 1;
+}
@@ -0,0 +1,474 @@
+#include "gamedb.hpp"
+#include "bitboard.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+#define GAMEDB_START_BLACK 0x0000000810000000ULL
+#define GAMEDB_START_WHITE 0x0000001008000000ULL
+
+static const char games_magic[8] = {'C', 'S', 'D', 'B', 'G', 'A', 'M', 'E'};
+static const char index_magic[8] = {'C', 'S', 'D', 'B', 'I', 'N', 'D', 'X'};
+
+/*
+ * Replaces (black, white) by the smallest of its eight symmetric copies.
+ */
+static void canonicalPosition(uint64_t &black, uint64_t &white)
+{
+    uint64_t best_black = black, best_white = white;
+    for (int sym = 1; sym < 8; ++sym)
+    {
+        uint64_t b = bbSymmetry(black, sym);
+        uint64_t w = bbSymmetry(white, sym);
+        if (b < best_black || (b == best_black && w < best_white))
+        {
+            best_black = b;
+            best_white = w;
+        }
+    }
+    black = best_black;
+    white = best_white;
+}
+
+static uint64_t mix(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/*
+ * Returns the index key of a position with side to move, the same for all
+ * eight symmetric copies of it.
+ */
+uint64_t GameDB::positionKey(uint64_t black, uint64_t white, Side side)
+{
+    canonicalPosition(black, white);
+    return mix(black ^ mix(white + 0x9e3779b97f4a7c15ULL)) ^ (side == WHITE ? 0x5bd1e995ULL : 0);
+}
+
+/*
+ * Plays the move byte m for side on the bitboards; returns false if it is
+ * not legal. Passes are legal only when side has no move.
+ */
+static bool playMove(uint64_t &black, uint64_t &white, Side side, int m)
+{
+    uint64_t &own = (side == BLACK) ? black : white;
+    uint64_t &opp = (side == BLACK) ? white : black;
+    if (m == GAMEDB_PASS)
+    {
+        return bbMoves(own, opp) == 0;
+    }
+    uint64_t flips = bbFlips(own, opp, m);
+    if (flips == 0 || ((black | white) & (1ULL << m)))
+    {
+        return false;
+    }
+    own |= flips | (1ULL << m);
+    opp &= ~flips;
+    return true;
+}
+
+/*
+ * Parses a game written the way Player::made_moves is ("f5d6c3...", one
+ * letter and digit per move, passes left out) into move bytes with explicit
+ * passes. Returns false if the line is malformed or a move is illegal.
+ */
+bool GameDB::parseGame(const string &line, vector<uint8_t> &moves, int *result)
+{
+    uint64_t black = GAMEDB_START_BLACK, white = GAMEDB_START_WHITE;
+    Side side = BLACK;
+    moves.clear();
+
+    for (size_t i = 0; i + 1 < line.length(); i += 2)
+    {
+        int x = tolower(line[i]) - 'a';
+        int y = line[i + 1] - '1';
+        if (x < 0 || x >= 8 || y < 0 || y >= 8)
+        {
+            return false;
+        }
+
+        uint64_t own = (side == BLACK) ? black : white;
+        uint64_t opp = (side == BLACK) ? white : black;
+        if (bbMoves(own, opp) == 0)
+        {
+            moves.push_back(GAMEDB_PASS);
+            side = (side == BLACK) ? WHITE : BLACK;
+        }
+
+        if (!playMove(black, white, side, x + 8 * y) || moves.size() >= 255)
+        {
+            return false;
+        }
+        moves.push_back(x + 8 * y);
+        side = (side == BLACK) ? WHITE : BLACK;
+    }
+
+    *result = bbCount(black) - bbCount(white);
+    return !moves.empty();
+}
+
+/*
+ * Turns move bytes back into the made_moves text form, passes left out.
+ */
+string GameDB::moveString(const vector<uint8_t> &moves)
+{
+    string str;
+    for (uint i = 0; i < moves.size(); ++i)
+    {
+        if (moves[i] != GAMEDB_PASS)
+        {
+            str += (char) ('a' + moves[i] % 8);
+            str += (char) ('1' + moves[i] / 8);
+        }
+    }
+    return str;
+}
+
+/*
+ * The part of an import done by one thread: its records, laid out as they
+ * will be in the games file, and (key, record offset) pairs sorted by key.
+ */
+struct ImportChunk {
+    vector<uint8_t> records;
+    vector<pair<uint64_t, uint64_t> > entries;
+    int games;
+    int rejected;
+};
+
+static void importLines(const vector<string> *lines, size_t begin, size_t end,
+                        ImportChunk *chunk)
+{
+    vector<uint8_t> moves;
+    chunk->games = 0;
+    chunk->rejected = 0;
+
+    for (size_t i = begin; i < end; ++i)
+    {
+        int result;
+        if (!GameDB::parseGame((*lines)[i], moves, &result))
+        {
+            ++chunk->rejected;
+            continue;
+        }
+
+        uint64_t offset = chunk->records.size();
+        chunk->records.push_back(moves.size());
+        chunk->records.push_back((uint8_t) (int8_t) result);
+        chunk->records.insert(chunk->records.end(), moves.begin(), moves.end());
+        ++chunk->games;
+
+        // The first few plies are shared by nearly every game and would only
+        // produce huge posting lists, so positions are indexed from ply 4.
+        uint64_t black = GAMEDB_START_BLACK, white = GAMEDB_START_WHITE;
+        Side side = BLACK;
+        for (uint ply = 0; ply < moves.size(); ++ply)
+        {
+            playMove(black, white, side, moves[ply]);
+            side = (side == BLACK) ? WHITE : BLACK;
+            if (ply >= 3)
+            {
+                chunk->entries.push_back(make_pair(GameDB::positionKey(black, white, side), offset));
+            }
+        }
+    }
+
+    sort(chunk->entries.begin(), chunk->entries.end());
+}
+
+static bool writeAll(FILE *f, const void *data, size_t size)
+{
+    return size == 0 || fwrite(data, 1, size, f) == size;
+}
+
+/*
+ * Builds the database <db> from a text file with one game per line, parsing
+ * and indexing the games on the given number of threads.
+ */
+bool GameDB::import(const string &db, const string &text_file, int threads)
+{
+    ifstream in(text_file);
+    if (!in)
+    {
+        cerr << "cannot read " << text_file << endl;
+        return false;
+    }
+    vector<string> lines;
+    string line;
+    while (getline(in, line))
+    {
+        if (!line.empty() && line[line.length() - 1] == '\r')
+        {
+            line.erase(line.length() - 1);
+        }
+        if (!line.empty())
+        {
+            lines.push_back(line);
+        }
+    }
+
+    threads = max(1, threads);
+    vector<ImportChunk> chunks(threads);
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+        size_t begin = lines.size() * t / threads;
+        size_t end = lines.size() * (t + 1) / threads;
+        workers.push_back(thread(importLines, &lines, begin, end, &chunks[t]));
+    }
+    for (int t = 0; t < threads; ++t)
+    {
+        workers[t].join();
+    }
+
+    // Games file: the chunks one after the other.
+    FILE *games_file = fopen((db + ".games").c_str(), "wb");
+    if (games_file == nullptr)
+    {
+        perror((db + ".games").c_str());
+        return false;
+    }
+    bool ok = writeAll(games_file, games_magic, sizeof(games_magic));
+    uint64_t base = sizeof(games_magic);
+    int games = 0, rejected = 0;
+    vector<pair<uint64_t, uint64_t> > entries;
+    for (int t = 0; t < threads; ++t)
+    {
+        ok = ok && writeAll(games_file, chunks[t].records.data(), chunks[t].records.size());
+        size_t mid = entries.size();
+        for (uint i = 0; i < chunks[t].entries.size(); ++i)
+        {
+            entries.push_back(make_pair(chunks[t].entries[i].first,
+                                        chunks[t].entries[i].second + base));
+        }
+        inplace_merge(entries.begin(), entries.begin() + mid, entries.end());
+        base += chunks[t].records.size();
+        games += chunks[t].games;
+        rejected += chunks[t].rejected;
+        vector<uint8_t>().swap(chunks[t].records);
+        vector<pair<uint64_t, uint64_t> >().swap(chunks[t].entries);
+    }
+    ok = (fclose(games_file) == 0) && ok;
+
+    // Index: one slot per distinct key, at most three quarters full.
+    uint64_t distinct = 0;
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        if (i == 0 || entries[i].first != entries[i - 1].first)
+        {
+            ++distinct;
+        }
+    }
+    uint64_t num_slots = 16;
+    while (3 * num_slots < 4 * distinct)
+    {
+        num_slots *= 2;
+    }
+
+    vector<GameDBSlot> table(num_slots);
+    vector<uint64_t> postings(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        postings[i] = entries[i].second;
+        if (i > 0 && entries[i].first == entries[i - 1].first)
+        {
+            continue;
+        }
+        uint64_t slot = entries[i].first & (num_slots - 1);
+        while (table[slot].count != 0)
+        {
+            slot = (slot + 1) & (num_slots - 1);
+        }
+        table[slot].key = entries[i].first;
+        table[slot].first = i;
+        size_t j = i;
+        while (j < entries.size() && entries[j].first == entries[i].first)
+        {
+            ++j;
+        }
+        table[slot].count = j - i;
+    }
+
+    FILE *index_file = fopen((db + ".index").c_str(), "wb");
+    if (index_file == nullptr)
+    {
+        perror((db + ".index").c_str());
+        return false;
+    }
+    uint64_t num_postings = postings.size();
+    ok = ok && writeAll(index_file, index_magic, sizeof(index_magic));
+    ok = ok && writeAll(index_file, &num_slots, sizeof(num_slots));
+    ok = ok && writeAll(index_file, &num_postings, sizeof(num_postings));
+    ok = ok && writeAll(index_file, table.data(), num_slots * sizeof(GameDBSlot));
+    ok = ok && writeAll(index_file, postings.data(), num_postings * sizeof(uint64_t));
+    ok = (fclose(index_file) == 0) && ok;
+
+    cerr << "imported " << games << " games (" << rejected << " rejected), "
+         << num_postings << " positions, " << distinct << " distinct" << endl;
+    if (!ok)
+    {
+        cerr << "write error while importing " << db << endl;
+    }
+    return ok;
+}
+
+GameDB::GameDB()
+{
+    num_slots = 0;
+    games_fd = index_fd = -1;
+    games = index = nullptr;
+    games_size = index_size = 0;
+    slots = nullptr;
+    postings = nullptr;
+    num_postings = 0;
+}
+
+GameDB::~GameDB()
+{
+    close();
+}
+
+static const uint8_t *mapFile(const string &path, int *fd, size_t *size)
+{
+    *fd = ::open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (*fd < 0 || fstat(*fd, &st) < 0)
+    {
+        perror(path.c_str());
+        return nullptr;
+    }
+    *size = st.st_size;
+    void *data = mmap(nullptr, *size, PROT_READ, MAP_SHARED, *fd, 0);
+    if (data == MAP_FAILED)
+    {
+        perror(path.c_str());
+        return nullptr;
+    }
+    return (const uint8_t *) data;
+}
+
+/*
+ * Maps the database <db> for querying. Returns false if either file is
+ * missing or is not a game database.
+ */
+bool GameDB::open(const string &db)
+{
+    close();
+    games = mapFile(db + ".games", &games_fd, &games_size);
+    index = mapFile(db + ".index", &index_fd, &index_size);
+    if (games == nullptr || index == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    size_t header = sizeof(index_magic) + 2 * sizeof(uint64_t);
+    if (games_size < sizeof(games_magic) || memcmp(games, games_magic, sizeof(games_magic)) ||
+        index_size < header || memcmp(index, index_magic, sizeof(index_magic)))
+    {
+        cerr << db << " is not a game database" << endl;
+        close();
+        return false;
+    }
+
+    memcpy(&num_slots, index + sizeof(index_magic), sizeof(uint64_t));
+    memcpy(&num_postings, index + sizeof(index_magic) + sizeof(uint64_t), sizeof(uint64_t));
+    if (index_size != header + num_slots * sizeof(GameDBSlot) + num_postings * sizeof(uint64_t))
+    {
+        cerr << db << ".index is truncated" << endl;
+        close();
+        return false;
+    }
+    slots = (const GameDBSlot *) (index + header);
+    postings = (const uint64_t *) (slots + num_slots);
+    return true;
+}
+
+void GameDB::close()
+{
+    if (games != nullptr) munmap((void *) games, games_size);
+    if (index != nullptr) munmap((void *) index, index_size);
+    if (games_fd >= 0) ::close(games_fd);
+    if (index_fd >= 0) ::close(index_fd);
+    games_fd = index_fd = -1;
+    games = index = nullptr;
+    slots = nullptr;
+    postings = nullptr;
+    num_slots = num_postings = 0;
+}
+
+bool GameDB::readGame(uint64_t offset, vector<uint8_t> &moves, int *result)
+{
+    if (offset + 2 > games_size || offset + 2 + games[offset] > games_size)
+    {
+        return false;
+    }
+    moves.assign(games + offset + 2, games + offset + 2 + games[offset]);
+    *result = (int8_t) games[offset + 1];
+    return true;
+}
+
+/*
+ * Returns the games that reached the position, or any of its symmetric
+ * copies, with side to move. Each candidate from the index is replayed to
+ * confirm the match and find the ply at which it happened.
+ */
+vector<GameDBMatch> GameDB::find(uint64_t black, uint64_t white, Side side)
+{
+    vector<GameDBMatch> matches;
+    if (slots == nullptr)
+    {
+        return matches;
+    }
+
+    uint64_t key = positionKey(black, white, side);
+    canonicalPosition(black, white);
+
+    uint64_t slot = key & (num_slots - 1);
+    while (slots[slot].count != 0 && slots[slot].key != key)
+    {
+        slot = (slot + 1) & (num_slots - 1);
+    }
+    if (slots[slot].count == 0)
+    {
+        return matches;
+    }
+
+    for (uint64_t i = slots[slot].first; i < slots[slot].first + slots[slot].count; ++i)
+    {
+        GameDBMatch match;
+        match.offset = postings[i];
+        if (!readGame(match.offset, match.moves, &match.result))
+        {
+            continue;
+        }
+
+        uint64_t b = GAMEDB_START_BLACK, w = GAMEDB_START_WHITE;
+        Side to_move = BLACK;
+        for (uint ply = 0; ply < match.moves.size(); ++ply)
+        {
+            playMove(b, w, to_move, match.moves[ply]);
+            to_move = (to_move == BLACK) ? WHITE : BLACK;
+            uint64_t cb = b, cw = w;
+            canonicalPosition(cb, cw);
+            if (cb == black && cw == white && to_move == side)
+            {
+                match.ply = ply + 1;
+                matches.push_back(match);
+                break;
+            }
+        }
+    }
+    return matches;
+}
@@ -0,0 +1,74 @@
+#ifndef __GAMEDB_H__
+#define __GAMEDB_H__
+
+#include "common.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*
+ * Database of finished games with an index from positions to the games that
+ * reached them. A database <db> is two files:
+ *
+ *   <db>.games  "CSDBGAME" then one record per game: the number of moves
+ *               (one byte), black's final disc lead (one signed byte) and one
+ *               byte per move, x + 8 * y or GAMEDB_PASS.
+ *   <db>.index  "CSDBINDX", the slot count (a power of two), the posting
+ *               count, an open addressing hash table with one slot per
+ *               distinct position key and then the postings: the record
+ *               offsets of the games reaching each key, stored together.
+ *
+ * Position keys are taken over the symmetry-normalised position, so a query
+ * also finds games that reached a rotated or mirrored copy of it. Queries
+ * map both files and only touch the slots and records they need.
+ */
+
+#define GAMEDB_PASS 64
+
+struct GameDBSlot {
+    uint64_t key;
+    // Index of the first posting and number of postings; count 0 is empty.
+    uint64_t first;
+    uint64_t count;
+};
+
+struct GameDBMatch {
+    uint64_t offset;
+    int ply;
+    int result;
+    vector<uint8_t> moves;
+};
+
+class GameDB {
+public:
+    GameDB();
+    ~GameDB();
+
+    static bool import(const string &db, const string &text_file, int threads);
+    static bool parseGame(const string &line, vector<uint8_t> &moves, int *result);
+    static uint64_t positionKey(uint64_t black, uint64_t white, Side side);
+    static string moveString(const vector<uint8_t> &moves);
+
+    bool open(const string &db);
+    void close();
+    vector<GameDBMatch> find(uint64_t black, uint64_t white, Side side);
+
+    uint64_t num_slots;
+
+private:
+    bool readGame(uint64_t offset, vector<uint8_t> &moves, int *result);
+
+    int games_fd;
+    int index_fd;
+    const uint8_t *games;
+    size_t games_size;
+    const uint8_t *index;
+    size_t index_size;
+    const GameDBSlot *slots;
+    const uint64_t *postings;
+    uint64_t num_postings;
+};
+
+#endif
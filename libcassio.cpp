@@ -0,0 +1,108 @@
+#include "cassio.h"
+#include "player.hpp"
+#include "threadpool.hpp"
+#include <cmath>
+
+struct cassio_engine {
+    int depth;
+    ThreadPool *pool;
+};
+
+static bool validPosition(uint64_t black, uint64_t white, int side)
+{
+    return (black & white) == 0 && (side == CASSIO_WHITE || side == CASSIO_BLACK);
+}
+
+cassio_engine *cassio_engine_new(int depth, int threads)
+{
+    if (depth < 1)
+    {
+        return nullptr;
+    }
+    if (threads <= 0)
+    {
+        threads = max(1, (int) thread::hardware_concurrency());
+    }
+
+    cassio_engine *engine = new cassio_engine;
+    engine->depth = depth;
+    engine->pool = new ThreadPool(threads);
+    return engine;
+}
+
+void cassio_engine_free(cassio_engine *engine)
+{
+    if (engine != nullptr)
+    {
+        delete engine->pool;
+        delete engine;
+    }
+}
+
+int cassio_evaluate_batch(cassio_engine *engine, const uint64_t *black,
+                          const uint64_t *white, const int *sides, size_t n,
+                          double *scores)
+{
+    if (engine == nullptr || black == nullptr || white == nullptr ||
+        sides == nullptr || scores == nullptr)
+    {
+        return -1;
+    }
+
+    atomic<int> invalid(0);
+    engine->pool->parallelFor(n, [&](size_t i) {
+        if (!validPosition(black[i], white[i], sides[i]))
+        {
+            scores[i] = NAN;
+            ++invalid;
+            return;
+        }
+        Player player(sides[i] == CASSIO_BLACK ? BLACK : WHITE);
+        player.board.setBitboards(black[i], white[i]);
+        scores[i] = player.evaluate(player.board);
+    });
+    return invalid;
+}
+
+int cassio_search_batch(cassio_engine *engine, const uint64_t *black,
+                        const uint64_t *white, const int *sides, size_t n,
+                        int *moves, double *scores)
+{
+    if (engine == nullptr || black == nullptr || white == nullptr ||
+        sides == nullptr || moves == nullptr || scores == nullptr)
+    {
+        return -1;
+    }
+
+    atomic<int> invalid(0);
+    engine->pool->parallelFor(n, [&](size_t i) {
+        moves[i] = CASSIO_PASS;
+        if (!validPosition(black[i], white[i], sides[i]))
+        {
+            scores[i] = NAN;
+            ++invalid;
+            return;
+        }
+        Player player(sides[i] == CASSIO_BLACK ? BLACK : WHITE);
+        player.board.setBitboards(black[i], white[i]);
+        player.depth = engine->depth;
+
+        Move *m = player.doABMinimaxMove();
+        if (m != nullptr)
+        {
+            moves[i] = m->getX() + BOARDSIZE * m->getY();
+            scores[i] = player.best_score;
+            delete m;
+        }
+        else
+        {
+            scores[i] = player.evaluate(player.board);
+        }
+    });
+    return invalid;
+}
+
+const char *cassio_version(void)
+{
+    return "cassio 1.0";
+}
@@ -0,0 +1,131 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include "scheduler.hpp"
+using namespace std;
+
+/*
+ * Loads a JobScheduler with deep batch analyses, more than there are
+ * workers, and meanwhile submits shallow interactive queries at random
+ * (Poisson) intervals. Once every query has been answered it prints the
+ * scheduler's report, so the interactive latencies are those seen under a
+ * full batch load, and how far the batch jobs got meanwhile. Run it with
+ * and without -P to see what preemption buys and what it costs.
+ *
+ * usage: loadtest [-j threads] [-b batch_jobs] [-d batch_depth]
+ *                 [-i queries] [-q query_depth] [-r queries_per_s]
+ *                 [-n lines] [-s seed] [-P]
+ *
+ *   -P  don't preempt batch jobs
+ */
+
+static Board randomPosition(mt19937 &rng, int plies, Side *turn) {
+    Board board;
+    *turn = BLACK;
+    for (int i = 0; i < plies && !board.isDone(); i++) {
+        vector<Move> moves;
+        for (int x = 0; x < BOARDSIZE; x++) {
+            for (int y = 0; y < BOARDSIZE; y++) {
+                Move m(x, y);
+                if (board.checkMove(&m, *turn)) moves.push_back(m);
+            }
+        }
+        if (!moves.empty()) board.doMove(&moves[rng() % moves.size()], *turn);
+        *turn = (*turn == BLACK) ? WHITE : BLACK;
+    }
+    return board;
+}
+
+static AnalysisJob *makeJob(mt19937 &rng, JobClass priority, int depth, int lines) {
+    AnalysisJob *job = new AnalysisJob();
+    job->priority = priority;
+    job->board = randomPosition(rng, 8 + rng() % 20, &job->side);
+    job->depth = depth;
+    job->lines = lines;
+    return job;
+}
+
+int main(int argc, char *argv[]) {
+    int threads = thread::hardware_concurrency();
+    int batch_jobs = 0;
+    int batch_depth = 14;
+    int queries = 50;
+    int query_depth = 6;
+    double rate = 5;
+    int lines = 3;
+    unsigned seed = 1;
+    bool preempt = true;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-j") && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-b") && i + 1 < argc) batch_jobs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-d") && i + 1 < argc) batch_depth = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-i") && i + 1 < argc) queries = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-q") && i + 1 < argc) query_depth = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-r") && i + 1 < argc) rate = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc) lines = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-s") && i + 1 < argc) seed = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-P")) preempt = false;
+        else {
+            cerr << "usage: " << argv[0] << " [-j threads] [-b batch_jobs] [-d batch_depth]"
+                 << " [-i queries] [-q query_depth] [-r queries_per_s] [-n lines] [-s seed]"
+                 << " [-P]" << endl;
+            exit(-1);
+        }
+    }
+    threads = max(threads, 1);
+    // Enough batch work that no worker runs dry before the queries are done.
+    if (batch_jobs <= 0) batch_jobs = 4 * threads;
+
+    mt19937 rng(seed);
+    vector<AnalysisJob *> jobs;
+    atomic<int> answered(0);
+    JobScheduler *scheduler = new JobScheduler(threads, preempt);
+
+    for (int i = 0; i < batch_jobs; i++) {
+        jobs.push_back(makeJob(rng, JOB_BATCH, batch_depth, lines));
+        scheduler->submit(jobs.back());
+    }
+
+    // Let every worker get well into a batch job first.
+    this_thread::sleep_for(chrono::milliseconds(500));
+    cout << threads << " workers, " << batch_jobs << " batch jobs to depth " << batch_depth
+         << ", " << queries << " queries to depth " << query_depth << " at " << rate
+         << "/s, preemption " << (preempt ? "on" : "off") << endl;
+
+    exponential_distribution<double> interval(rate);
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < queries; i++) {
+        this_thread::sleep_for(chrono::duration<double>(interval(rng)));
+        jobs.push_back(makeJob(rng, JOB_INTERACTIVE, query_depth, lines));
+        jobs.back()->done = [&answered](AnalysisJob *) { ++answered; };
+        scheduler->submit(jobs.back());
+    }
+    while (answered < queries) {
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "queries answered in " << elapsed << " s" << endl;
+    scheduler->report(cout);
+    cout << "interactive p99 " << scheduler->latencyPercentile(JOB_INTERACTIVE, 99)
+         << " ms with " << scheduler->running(JOB_BATCH) + scheduler->queued(JOB_BATCH)
+         << " batch jobs still unfinished" << endl;
+
+    // The batch jobs are abandoned; stop the workers before reading them.
+    delete scheduler;
+    int batch_done = 0;
+    cout << "batch depths reached:";
+    for (int i = 0; i < batch_jobs; i++) {
+        cout << " " << jobs[i]->depth_reached;
+        if (jobs[i]->depth_reached >= batch_depth) batch_done++;
+    }
+    cout << endl << batch_done << " of " << batch_jobs << " batch jobs done, "
+         << (batch_jobs - batch_done) << " abandoned" << endl;
+    for (AnalysisJob *job : jobs) delete job;
+    return 0;
+}
@@ -0,0 +1,446 @@
+#include "mcts.hpp"
+#include "bitboard.hpp"
+#include "memory.hpp"
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+static long long nowMicros()
+{
+    return chrono::duration_cast<chrono::microseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static inline uint64_t nextRandom(uint64_t &state)
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+/*
+ * Returns the index of a random set bit of b, which must be non-zero.
+ */
+static inline int randomBit(uint64_t b, uint64_t &rng)
+{
+    int n = nextRandom(rng) % bbCount(b);
+    while (n-- > 0)
+    {
+        b &= b - 1;
+    }
+    return __builtin_ctzll(b);
+}
+
+/*
+ * Plays random moves from P to move until the game ends. Returns 1 if the
+ * side owning P wins, -1 if it loses and 0 for a draw.
+ */
+static int playout(uint64_t P, uint64_t O, uint64_t &rng)
+{
+    int sign = 1;
+    while (true)
+    {
+        uint64_t moves = bbMoves(P, O);
+        if (moves == 0)
+        {
+            if (bbMoves(O, P) == 0)
+            {
+                break;
+            }
+        }
+        else
+        {
+            int sq = randomBit(moves, rng);
+            uint64_t flips = bbFlips(P, O, sq);
+            P |= flips | (1ULL << sq);
+            O &= ~flips;
+        }
+        uint64_t tmp = P;
+        P = O;
+        O = tmp;
+        sign = -sign;
+    }
+
+    int diff = bbCount(P) - bbCount(O);
+    return (diff > 0) ? sign : (diff < 0) ? -sign : 0;
+}
+
+MCTS::MCTS(size_t pool_bytes, int threads)
+{
+    this->threads = threads;
+    exploration = 1.0;
+    virtual_loss = 3;
+    stop = nullptr;
+    last_playouts = 0;
+    last_ms = 0;
+    reused_visits = 0;
+
+    stack_bytes = (threads - 1) * (size_t) MEMORY_THREAD_STACK;
+    MemoryBudget::instance().reserve("mcts threads", stack_bytes);
+
+    // Nodes need no construction: every field is set when a node is handed
+    // out by reset() or expand().
+    size_t actual;
+    pool = (MCTSNode *) MemoryBudget::instance().allocate("mcts", pool_bytes, 1 << 20, &actual);
+    heap_pool = (pool == nullptr);
+    if (heap_pool)
+    {
+        cerr << "mcts: node pool allocation failed, using a small heap pool" << endl;
+        actual = 4096 * sizeof(MCTSNode);
+        pool = new MCTSNode[4096];
+    }
+    pool_size = actual / sizeof(MCTSNode);
+    root_side = BLACK;
+    reset(Board().getBlack(), Board().getWhite(), BLACK);
+}
+
+MCTS::~MCTS()
+{
+    MemoryBudget::instance().unreserve("mcts threads", stack_bytes);
+    if (heap_pool)
+    {
+        delete[] pool;
+    }
+    else
+    {
+        MemoryBudget::instance().release(pool);
+    }
+}
+
+int MCTS::nodeCount()
+{
+    return min(next_free.load(), pool_size);
+}
+
+/*
+ * Throws the whole tree away and starts over from the given position.
+ */
+void MCTS::reset(uint64_t black, uint64_t white, Side side)
+{
+    root = 0;
+    root_black = black;
+    root_white = white;
+    root_side = side;
+    next_free = 1;
+    pool[0].visits = 0;
+    pool[0].score = 0;
+    pool[0].first_child = -1;
+    pool[0].num_children = 0;
+    pool[0].move = MCTS_PASS;
+}
+
+/*
+ * Plays sq (or a pass) for side on the black/white bitboards.
+ */
+static void applyMove(uint64_t &black, uint64_t &white, Side side, int sq)
+{
+    if (sq == MCTS_PASS)
+    {
+        return;
+    }
+    uint64_t &own = (side == BLACK) ? black : white;
+    uint64_t &opp = (side == BLACK) ? white : black;
+    uint64_t flips = bbFlips(own, opp, sq);
+    own |= flips | (1ULL << sq);
+    opp &= ~flips;
+}
+
+/*
+ * Looks for the given position among the expanded descendants of node, at
+ * most plies below it. (b, w, to_move) is the position at node. Returns the
+ * index of the matching node or -1.
+ */
+int MCTS::findPosition(int node, uint64_t b, uint64_t w, Side to_move,
+                       uint64_t black, uint64_t white, Side side, int plies)
+{
+    if (b == black && w == white && to_move == side)
+    {
+        return node;
+    }
+
+    int first = pool[node].first_child;
+    if (plies == 0 || first < 0)
+    {
+        return -1;
+    }
+
+    Side other = (to_move == BLACK) ? WHITE : BLACK;
+    for (int c = first; c < first + pool[node].num_children; ++c)
+    {
+        uint64_t cb = b, cw = w;
+        applyMove(cb, cw, to_move, pool[c].move);
+        int found = findPosition(c, cb, cw, other, black, white, side, plies - 1);
+        if (found >= 0)
+        {
+            return found;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Moves the root down to the given position if it is in the tree within two
+ * plies (our move and the reply) of the previous root, keeping the statistics
+ * gathered under it. Returns false if the position is not found.
+ */
+bool MCTS::reuse(uint64_t black, uint64_t white, Side side)
+{
+    int found = findPosition(root, root_black, root_white, root_side,
+                             black, white, side, 2);
+    if (found < 0)
+    {
+        return false;
+    }
+    root = found;
+    root_black = black;
+    root_white = white;
+    root_side = side;
+    return true;
+}
+
+/*
+ * Gives node one child per legal move of P (or a single pass child). Returns
+ * false if another thread is already expanding it or the pool is full, in
+ * which case the caller plays out from the node as a leaf.
+ */
+bool MCTS::expand(MCTSNode *node, uint64_t P, uint64_t O)
+{
+    int unexpanded = -1;
+    if (!node->first_child.compare_exchange_strong(unexpanded, -2))
+    {
+        return false;
+    }
+
+    uint64_t moves = bbMoves(P, O);
+    int n = bbCount(moves);
+    if (n == 0 && bbMoves(O, P) != 0)
+    {
+        n = 1;
+    }
+
+    int first = (next_free + n > pool_size) ? pool_size : next_free.fetch_add(n);
+    if (first + n > pool_size)
+    {
+        node->first_child = -1;
+        return false;
+    }
+
+    for (int i = 0; i < n; ++i)
+    {
+        MCTSNode *child = &pool[first + i];
+        child->visits = 0;
+        child->score = 0;
+        child->first_child = -1;
+        child->num_children = 0;
+        if (moves)
+        {
+            child->move = __builtin_ctzll(moves);
+            moves &= moves - 1;
+        }
+        else
+        {
+            child->move = MCTS_PASS;
+        }
+    }
+
+    node->num_children = n;
+    node->first_child.store(first, memory_order_release);
+    return true;
+}
+
+/*
+ * One search thread: repeatedly descends the tree by UCT, expands the leaf it
+ * reaches, plays out randomly from there and backs the result up the path.
+ * Thread 0 also reports the most visited root move to on_best.
+ */
+void MCTS::runThread(int id, long long deadline_us, atomic<long long> *playouts)
+{
+    uint64_t rng = 0x9e3779b97f4a7c15ULL * (id + 1) ^ nowMicros();
+    MCTSNode *path[128];
+    long long count = 0;
+
+    while (stop == nullptr || !stop->load(memory_order_relaxed))
+    {
+        if ((count & 63) == 0 && nowMicros() >= deadline_us)
+        {
+            break;
+        }
+        if (id == 0 && on_best && count % MCTS_REPORT_INTERVAL == 0)
+        {
+            int best = bestChild();
+            if (best >= 0 && pool[best].move != MCTS_PASS)
+            {
+                Move m(pool[best].move % BOARDSIZE, pool[best].move / BOARDSIZE);
+                on_best(m);
+            }
+        }
+
+        uint64_t P = (root_side == BLACK) ? root_black : root_white;
+        uint64_t O = (root_side == BLACK) ? root_white : root_black;
+        MCTSNode *node = &pool[root];
+        int depth = 0;
+        path[depth++] = node;
+        node->visits += 1;
+
+        // Selection.
+        while (true)
+        {
+            int first = node->first_child.load(memory_order_acquire);
+            if (first < 0)
+            {
+                break;
+            }
+            if (node->num_children == 0)
+            {
+                break;
+            }
+
+            double log_n = log((double) node->visits + 1);
+            double best = -1;
+            MCTSNode *best_child = nullptr;
+            for (int c = first; c < first + node->num_children; ++c)
+            {
+                MCTSNode *child = &pool[c];
+                int v = child->visits;
+                double value;
+                if (v == 0)
+                {
+                    value = 1e9 + (nextRandom(rng) & 1023);
+                }
+                else
+                {
+                    value = child->score / (2.0 * v) + exploration * sqrt(log_n / v);
+                }
+                if (value > best)
+                {
+                    best = value;
+                    best_child = child;
+                }
+            }
+
+            node = best_child;
+            node->visits += virtual_loss;
+            path[depth++] = node;
+            if (node->move != MCTS_PASS)
+            {
+                uint64_t flips = bbFlips(P, O, node->move);
+                P |= flips | (1ULL << node->move);
+                O &= ~flips;
+            }
+            uint64_t tmp = P;
+            P = O;
+            O = tmp;
+        }
+
+        // Expansion: step into one of the new children before the playout.
+        if (node->first_child < 0 && expand(node, P, O) && node->num_children > 0)
+        {
+            MCTSNode *child = &pool[node->first_child + nextRandom(rng) % node->num_children];
+            node = child;
+            node->visits += virtual_loss;
+            path[depth++] = node;
+            if (node->move != MCTS_PASS)
+            {
+                uint64_t flips = bbFlips(P, O, node->move);
+                P |= flips | (1ULL << node->move);
+                O &= ~flips;
+            }
+            uint64_t tmp = P;
+            P = O;
+            O = tmp;
+        }
+
+        // Simulation, from the point of view of the side that moved last.
+        int result = -playout(P, O, rng);
+
+        // Backpropagation, taking the virtual loss back off on the way.
+        for (int i = depth - 1; i >= 0; --i)
+        {
+            if (i > 0)
+            {
+                path[i]->visits += 1 - virtual_loss;
+            }
+            path[i]->score += result + 1;
+            result = -result;
+        }
+
+        ++count;
+    }
+
+    *playouts += count;
+}
+
+/*
+ * Searches the position for ms milliseconds and returns the most visited
+ * move, or nullptr if side has to pass.
+ */
+Move *MCTS::search(Board &board, Side side, int ms)
+{
+    uint64_t black = board.getBlack();
+    uint64_t white = board.getWhite();
+
+    // Start over if the tree does not contain the position or is nearly full.
+    reused_visits = 0;
+    if (nodeCount() > pool_size - pool_size / 8 || !reuse(black, white, side))
+    {
+        reset(black, white, side);
+    }
+    else
+    {
+        reused_visits = pool[root].visits;
+    }
+
+    long long start = nowMicros();
+    atomic<long long> playouts(0);
+
+    vector<thread> workers;
+    for (int i = 1; i < threads; ++i)
+    {
+        workers.push_back(thread(&MCTS::runThread, this, i, start + 1000LL * ms, &playouts));
+    }
+    runThread(0, start + 1000LL * ms, &playouts);
+    for (uint i = 0; i < workers.size(); ++i)
+    {
+        workers[i].join();
+    }
+
+    last_playouts = playouts;
+    last_ms = (nowMicros() - start) / 1000.0;
+
+    cerr << "mcts: " << last_playouts << " playouts in " << last_ms << " ms ("
+         << (long long) (last_playouts / (last_ms / 1000.0 + 1e-9)) << "/s), "
+         << nodeCount() << " nodes, " << reused_visits << " visits reused" << endl;
+
+    int best = bestChild();
+    if (best < 0 || pool[best].move == MCTS_PASS)
+    {
+        return nullptr;
+    }
+    return new Move(pool[best].move % BOARDSIZE, pool[best].move / BOARDSIZE);
+}
+
+/*
+ * The most visited child of the root, or -1 if it has not been expanded.
+ */
+int MCTS::bestChild()
+{
+    MCTSNode *node = &pool[root];
+    int first = node->first_child.load(memory_order_acquire);
+    if (first < 0 || node->num_children == 0)
+    {
+        return -1;
+    }
+
+    int best = first;
+    for (int c = first; c < first + node->num_children; ++c)
+    {
+        if (pool[c].visits > pool[best].visits)
+        {
+            best = c;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,84 @@
+#ifndef __MCTS_H__
+#define __MCTS_H__
+
+#include "common.hpp"
+#include "board.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+using namespace std;
+
+#define MCTS_PASS 64
+
+// Playouts of the first thread between reports of the most visited move.
+#define MCTS_REPORT_INTERVAL 4096
+
+/*
+ * A node of the search tree. Children of a node sit next to each other in
+ * the pool, starting at first_child. score counts two points per playout won
+ * and one per playout drawn by the side that made move, so that
+ * score / (2 * visits) is that side's winning rate.
+ */
+struct MCTSNode {
+    atomic<int> visits;
+    atomic<int> score;
+    // -1 while unexpanded, -2 while a thread is expanding it.
+    atomic<int> first_child;
+    uint8_t num_children;
+    uint8_t move;
+};
+
+/*
+ * Parallel Monte Carlo tree search with UCT selection. Nodes come from a
+ * fixed pool taken from the memory budget up front, threads share one tree
+ * and use virtual loss to spread out over it, and the tree under the actual
+ * game continuation is kept from one search to the next.
+ */
+class MCTS {
+public:
+    MCTS(size_t pool_bytes, int threads);
+    ~MCTS();
+
+    Move *search(Board &board, Side side, int ms);
+
+    int threads;
+    double exploration;
+    int virtual_loss;
+
+    // The search ends early once *stop is set, and hands the most visited
+    // root move to on_best every MCTS_REPORT_INTERVAL playouts while it
+    // runs; either may be left unset.
+    const atomic<bool> *stop;
+    function<void(Move &)> on_best;
+
+    // Statistics of the last search.
+    long long last_playouts;
+    double last_ms;
+    int reused_visits;
+
+private:
+    void reset(uint64_t black, uint64_t white, Side side);
+    bool reuse(uint64_t black, uint64_t white, Side side);
+    int findPosition(int node, uint64_t b, uint64_t w, Side to_move,
+                     uint64_t black, uint64_t white, Side side, int plies);
+    bool expand(MCTSNode *node, uint64_t P, uint64_t O);
+    void runThread(int id, long long deadline_us, atomic<long long> *playouts);
+    int bestChild();
+    int nodeCount();
+
+    MCTSNode *pool;
+    int pool_size;
+    bool heap_pool;
+    // Thread stacks reserved from the memory budget.
+    size_t stack_bytes;
+    atomic<int> next_free;
+
+    // The position at the root, with root_side to move.
+    int root;
+    uint64_t root_black;
+    uint64_t root_white;
+    Side root_side;
+};
+
+#endif
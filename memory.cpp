@@ -0,0 +1,193 @@
+#include "memory.hpp"
+#include <cstdio>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#define HUGE_PAGE_SIZE (2 << 20)
+
+MemoryBudget::MemoryBudget()
+{
+    total = (size_t) MEMORY_DEFAULT_MB << 20;
+    used = 0;
+}
+
+MemoryBudget &MemoryBudget::instance()
+{
+    static MemoryBudget budget;
+    return budget;
+}
+
+void MemoryBudget::setTotal(size_t bytes)
+{
+    lock_guard<mutex> guard(lock);
+    total = bytes;
+}
+
+/*
+ * Returns the given fraction of the whole budget, which is what a table
+ * should ask for before the cap on free memory is applied.
+ */
+size_t MemoryBudget::share(double fraction)
+{
+    return (size_t) (total * fraction);
+}
+
+size_t MemoryBudget::available()
+{
+    return (used < total) ? total - used : 0;
+}
+
+/*
+ * Maps size bytes, with huge pages if the kernel has them reserved, else
+ * with a transparent huge page hint. Returns nullptr if the mapping fails.
+ */
+static void *mapPages(size_t size, const char **pages)
+{
+#ifdef MAP_HUGETLB
+    if (size % HUGE_PAGE_SIZE == 0)
+    {
+        void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED)
+        {
+            *pages = "huge pages";
+            return p;
+        }
+    }
+#endif
+
+    void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+    {
+        return nullptr;
+    }
+    *pages = "";
+#ifdef MADV_HUGEPAGE
+    if (madvise(p, size, MADV_HUGEPAGE) == 0)
+    {
+        *pages = "transparent huge pages";
+    }
+#endif
+    return p;
+}
+
+/*
+ * Allocates zeroed memory for the table called name: desired bytes, capped
+ * by what is left of the budget, halving on failure down to minimum. Stores
+ * the size obtained in actual and returns nullptr if not even minimum bytes
+ * could be had.
+ */
+void *MemoryBudget::allocate(const string &name, size_t desired, size_t minimum, size_t *actual)
+{
+    lock_guard<mutex> guard(lock);
+
+    size_t size = min(desired, available());
+    if (size >= HUGE_PAGE_SIZE)
+    {
+        size -= size % HUGE_PAGE_SIZE;
+    }
+
+    while (size >= minimum && size > 0)
+    {
+        const char *pages;
+        void *p = mapPages(size, &pages);
+        if (p != nullptr)
+        {
+            MemoryBlock block = {name, p, size, pages};
+            blocks.push_back(block);
+            used += size;
+            *actual = size;
+            return p;
+        }
+        size /= 2;
+    }
+
+    *actual = 0;
+    return nullptr;
+}
+
+void MemoryBudget::release(void *ptr)
+{
+    lock_guard<mutex> guard(lock);
+    for (uint i = 0; i < blocks.size(); ++i)
+    {
+        if (blocks[i].ptr == ptr && ptr != nullptr)
+        {
+            munmap(ptr, blocks[i].size);
+            used -= blocks[i].size;
+            blocks.erase(blocks.begin() + i);
+            return;
+        }
+    }
+}
+
+/*
+ * Takes bytes off the budget for memory that is not allocated through it,
+ * such as thread stacks.
+ */
+void MemoryBudget::reserve(const string &name, size_t bytes)
+{
+    if (bytes == 0)
+    {
+        return;
+    }
+    lock_guard<mutex> guard(lock);
+    MemoryBlock block = {name, nullptr, bytes, "reserved"};
+    blocks.push_back(block);
+    used += bytes;
+}
+
+/*
+ * Gives back bytes reserved under name, once that memory is freed.
+ */
+void MemoryBudget::unreserve(const string &name, size_t bytes)
+{
+    lock_guard<mutex> guard(lock);
+    for (uint i = 0; i < blocks.size(); ++i)
+    {
+        if (blocks[i].ptr == nullptr && blocks[i].name == name && blocks[i].size == bytes)
+        {
+            used -= bytes;
+            blocks.erase(blocks.begin() + i);
+            return;
+        }
+    }
+}
+
+/*
+ * Prints every table with its size, the budget, and the process's current
+ * and peak resident set size.
+ */
+void MemoryBudget::report(ostream &out)
+{
+    lock_guard<mutex> guard(lock);
+    char line[128];
+
+    for (uint i = 0; i < blocks.size(); ++i)
+    {
+        snprintf(line, sizeof(line), "memory: %-16s %8.1f MB %s\n", blocks[i].name.c_str(),
+                 blocks[i].size / 1048576.0, blocks[i].pages);
+        out << line;
+    }
+
+    long rss_pages = 0;
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (statm != nullptr)
+    {
+        if (fscanf(statm, "%*s %ld", &rss_pages) != 1)
+        {
+            rss_pages = 0;
+        }
+        fclose(statm);
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    snprintf(line, sizeof(line), "memory: %.1f of %.1f MB budgeted, rss %.1f MB, peak rss %.1f MB\n",
+             used / 1048576.0, total / 1048576.0,
+             rss_pages * (double) sysconf(_SC_PAGESIZE) / 1048576.0,
+             usage.ru_maxrss / 1024.0);
+    out << line;
+}
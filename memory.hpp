@@ -0,0 +1,63 @@
+#ifndef __MEMORY_H__
+#define __MEMORY_H__
+
+#include <cstddef>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*
+ * The Java WrapperPlayer runs us under "ulimit -m/-v 786432" (768 MB) and
+ * going over it kills the process without a word, so every large table is
+ * carved out of one budget, set with --memory. The default leaves room for
+ * the code, the heap and the thread stacks.
+ */
+#define MEMORY_DEFAULT_MB 512
+
+// Fraction of the budget each table asks for; allocation is capped by what
+// is still free, so tables that are never used together may overlap.
+#define MEMORY_SHARE_MCTS 0.75
+#define MEMORY_SHARE_TT 0.25
+#define MEMORY_SHARE_SOLVER 0.125
+
+// Stack reserved per extra thread, the usual "ulimit -s" default.
+#define MEMORY_THREAD_STACK (8 << 20)
+
+struct MemoryBlock {
+    string name;
+    void *ptr;
+    size_t size;
+    // "huge pages", "transparent huge pages", "" for normal pages or
+    // "reserved" for memory that is only accounted for.
+    const char *pages;
+};
+
+class MemoryBudget {
+public:
+    static MemoryBudget &instance();
+
+    void setTotal(size_t bytes);
+    size_t share(double fraction);
+    size_t available();
+
+    void *allocate(const string &name, size_t desired, size_t minimum, size_t *actual);
+    void release(void *ptr);
+    void reserve(const string &name, size_t bytes);
+    void unreserve(const string &name, size_t bytes);
+
+    void report(ostream &out);
+
+    size_t total;
+    size_t used;
+
+private:
+    MemoryBudget();
+
+    vector<MemoryBlock> blocks;
+    mutex lock;
+};
+
+#endif
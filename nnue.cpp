@@ -0,0 +1,116 @@
+#include "nnue.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+static const char nnue_magic[8] = {'C', 'S', 'N', 'N', 'U', 'E', '0', '1'};
+
+/*
+ * Loads the network from file. Returns a new set of weights owned by the
+ * caller, or nullptr if the file is missing or malformed.
+ */
+NNUEWeights *nnueLoad(const string &file)
+{
+    FILE *f = fopen(file.c_str(), "rb");
+    if (f == nullptr)
+    {
+        perror(file.c_str());
+        return nullptr;
+    }
+
+    char magic[8];
+    NNUEWeights *weights = new NNUEWeights;
+    bool ok = fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+              memcmp(magic, nnue_magic, sizeof(magic)) == 0 &&
+              fread(weights, 1, sizeof(NNUEWeights), f) == sizeof(NNUEWeights);
+    fclose(f);
+
+    if (!ok)
+    {
+        cerr << file << " is not a network file" << endl;
+        delete weights;
+        return nullptr;
+    }
+    return weights;
+}
+
+bool nnueSave(const string &file, const NNUEWeights &weights)
+{
+    FILE *f = fopen(file.c_str(), "wb");
+    if (f == nullptr)
+    {
+        perror(file.c_str());
+        return false;
+    }
+    bool ok = fwrite(nnue_magic, 1, sizeof(nnue_magic), f) == sizeof(nnue_magic) &&
+              fwrite(&weights, 1, sizeof(weights), f) == sizeof(weights);
+    return (fclose(f) == 0) && ok;
+}
+
+/*
+ * Returns sum(a[i] * b[i]) over n int16 values, n a multiple of 16.
+ */
+static inline int32_t dot16(const int16_t *a, const int16_t *b, int n)
+{
+#if defined(__AVX2__)
+    __m256i sum = _mm256_setzero_si256();
+    for (int i = 0; i < n; i += 16)
+    {
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(
+            _mm256_loadu_si256((const __m256i *) (a + i)),
+            _mm256_loadu_si256((const __m256i *) (b + i))));
+    }
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+#elif defined(__SSE2__)
+    __m128i s = _mm_setzero_si128();
+    for (int i = 0; i < n; i += 8)
+    {
+        s = _mm_add_epi32(s, _mm_madd_epi16(_mm_loadu_si128((const __m128i *) (a + i)),
+                                            _mm_loadu_si128((const __m128i *) (b + i))));
+    }
+#endif
+#if defined(__AVX2__) || defined(__SSE2__)
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+    return _mm_cvtsi128_si32(s);
+#else
+    int32_t sum = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        sum += a[i] * b[i];
+    }
+    return sum;
+#endif
+}
+
+/*
+ * Runs the layers above the accumulator. Returns the score for black.
+ */
+double nnueEvaluate(const NNUEWeights *w, const int16_t *accumulator)
+{
+    int16_t hidden[NNUE_HIDDEN];
+    int16_t hidden2[NNUE_HIDDEN2];
+
+#if defined(__SSE2__)
+    for (int i = 0; i < NNUE_HIDDEN; i += 8)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *) (accumulator + i));
+        a = _mm_min_epi16(_mm_max_epi16(a, _mm_setzero_si128()), _mm_set1_epi16(127));
+        _mm_storeu_si128((__m128i *) (hidden + i), a);
+    }
+#else
+    for (int i = 0; i < NNUE_HIDDEN; ++i)
+    {
+        hidden[i] = min<int16_t>(max<int16_t>(accumulator[i], 0), 127);
+    }
+#endif
+
+    for (int o = 0; o < NNUE_HIDDEN2; ++o)
+    {
+        int32_t sum = (dot16(hidden, w->hidden_weights[o], NNUE_HIDDEN) + w->hidden_bias[o]) >> NNUE_SHIFT;
+        hidden2[o] = min(max(sum, 0), 127);
+    }
+
+    return (dot16(hidden2, w->output_weights, NNUE_HIDDEN2) + w->output_bias) / NNUE_OUTPUT_SCALE;
+}
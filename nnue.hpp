@@ -0,0 +1,82 @@
+#ifndef __NNUE_H__
+#define __NNUE_H__
+
+#include <cstdint>
+#include <string>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+/*
+ * Small quantised neural network evaluation, NNUE style. The first layer has
+ * one input per (colour, square); its output, the accumulator, lives in each
+ * Board given a network with setNetwork and is updated by doMove/undoMove
+ * from the placed and flipped stones only, so a leaf evaluation just runs
+ * the two small layers on top of it.
+ *
+ *   accumulator  int16[NNUE_HIDDEN]   = input_bias + sum of input_weights
+ *   hidden       clamp(acc, 0, 127)
+ *   layer 2      int16 weights, clamp((dot + bias) >> NNUE_SHIFT, 0, 127)
+ *   output       (dot + bias) / NNUE_OUTPUT_SCALE, black's point of view
+ *
+ * Weights come from a file written by "nnuetool train". Every Player that
+ * evaluates with a network loads and owns its own copy.
+ */
+
+#define NNUE_HIDDEN 32
+#define NNUE_HIDDEN2 32
+#define NNUE_SHIFT 6
+#define NNUE_OUTPUT_SCALE (127.0 * 256.0)
+
+// The network is trained on getBoardScore / NNUE_EVAL_SCALE.
+#define NNUE_EVAL_SCALE 1000.0
+
+struct NNUEWeights {
+    // Indexed by Side, then square x + 8 * y.
+    int16_t input_weights[2][64][NNUE_HIDDEN];
+    int16_t input_bias[NNUE_HIDDEN];
+    int16_t hidden_weights[NNUE_HIDDEN2][NNUE_HIDDEN];
+    int32_t hidden_bias[NNUE_HIDDEN2];
+    int16_t output_weights[NNUE_HIDDEN2];
+    int32_t output_bias;
+};
+
+NNUEWeights *nnueLoad(const string &file);
+bool nnueSave(const string &file, const NNUEWeights &weights);
+double nnueEvaluate(const NNUEWeights *weights, const int16_t *accumulator);
+
+/*
+ * acc += input_weights[colour][sq], or -= when add is false.
+ */
+static inline void nnueUpdate(const NNUEWeights *weights, int16_t *acc, int colour, int sq,
+                              bool add)
+{
+    const int16_t *w = weights->input_weights[colour][sq];
+#if defined(__AVX2__)
+    for (int i = 0; i < NNUE_HIDDEN; i += 16)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *) (acc + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *) (w + i));
+        a = add ? _mm256_add_epi16(a, b) : _mm256_sub_epi16(a, b);
+        _mm256_storeu_si256((__m256i *) (acc + i), a);
+    }
+#elif defined(__SSE2__)
+    for (int i = 0; i < NNUE_HIDDEN; i += 8)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *) (acc + i));
+        __m128i b = _mm_loadu_si128((const __m128i *) (w + i));
+        a = add ? _mm_add_epi16(a, b) : _mm_sub_epi16(a, b);
+        _mm_storeu_si128((__m128i *) (acc + i), a);
+    }
+#else
+    for (int i = 0; i < NNUE_HIDDEN; ++i)
+    {
+        acc[i] += add ? w[i] : -w[i];
+    }
+#endif
+}
+
+#endif
@@ -0,0 +1,269 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <vector>
+#include "bitboard.hpp"
+#include "board.hpp"
+#include "nnue.hpp"
+using namespace std;
+
+/*
+ * Trains and benchmarks the NNUE evaluation.
+ *
+ * usage: nnuetool train <weights> [positions] [epochs]
+ *        nnuetool bench <weights> [positions]
+ *
+ * train fits the network to getBoardScore on positions from random games (a
+ * distillation of the hand-written evaluation into a form that can be
+ * updated incrementally) and writes the quantised weights. bench compares
+ * evaluations per second and make/unmake cost against getBoardScore.
+ */
+
+struct Sample {
+    uint64_t black, white;
+    float target;
+};
+
+/*
+ * Positions from random games, with black's getBoardScore scaled down by
+ * NNUE_EVAL_SCALE as the target.
+ */
+static vector<Sample> makeSamples(int n, unsigned seed) {
+    mt19937_64 rng(seed);
+    vector<Sample> samples;
+    Board board;
+    while ((int) samples.size() < n) {
+        uint64_t P = 0x0000000810000000ULL, O = 0x0000001008000000ULL;
+        bool black_to_move = true;
+        int ply = 0;
+        while (true) {
+            uint64_t moves = bbMoves(P, O);
+            if (moves == 0) {
+                if (bbMoves(O, P) == 0) break;
+            } else {
+                int k = rng() % bbCount(moves);
+                while (k--) moves &= moves - 1;
+                int sq = __builtin_ctzll(moves);
+                uint64_t flips = bbFlips(P, O, sq);
+                P |= flips | (1ULL << sq);
+                O &= ~flips;
+                ply++;
+            }
+            swap(P, O);
+            black_to_move = !black_to_move;
+
+            if (ply >= 4 && rng() % 4 == 0 && (int) samples.size() < n) {
+                Sample s;
+                s.black = black_to_move ? P : O;
+                s.white = black_to_move ? O : P;
+                board.setBitboards(s.black, s.white);
+                s.target = board.getBoardScore(BLACK) / NNUE_EVAL_SCALE;
+                samples.push_back(s);
+            }
+        }
+    }
+    return samples;
+}
+
+/*
+ * Floating point copy of the network used for training.
+ */
+struct FloatNet {
+    float w1[128][NNUE_HIDDEN], b1[NNUE_HIDDEN];
+    float w2[NNUE_HIDDEN2][NNUE_HIDDEN], b2[NNUE_HIDDEN2];
+    float w3[NNUE_HIDDEN2], b3;
+};
+
+static int features(const Sample &s, int *f) {
+    int n = 0;
+    for (uint64_t b = s.white; b; b &= b - 1) f[n++] = WHITE * 64 + __builtin_ctzll(b);
+    for (uint64_t b = s.black; b; b &= b - 1) f[n++] = BLACK * 64 + __builtin_ctzll(b);
+    return n;
+}
+
+/*
+ * One SGD step on a sample; returns the squared error before the step.
+ */
+static float trainStep(FloatNet &net, const Sample &s, float lr) {
+    int f[64];
+    int nf = features(s, f);
+    float a1[NNUE_HIDDEN], h1[NNUE_HIDDEN], a2[NNUE_HIDDEN2], h2[NNUE_HIDDEN2];
+
+    for (int i = 0; i < NNUE_HIDDEN; i++) {
+        a1[i] = net.b1[i];
+        for (int k = 0; k < nf; k++) a1[i] += net.w1[f[k]][i];
+        h1[i] = min(max(a1[i], 0.0f), 1.0f);
+    }
+    float y = net.b3;
+    for (int o = 0; o < NNUE_HIDDEN2; o++) {
+        a2[o] = net.b2[o];
+        for (int i = 0; i < NNUE_HIDDEN; i++) a2[o] += net.w2[o][i] * h1[i];
+        h2[o] = min(max(a2[o], 0.0f), 1.0f);
+        y += net.w3[o] * h2[o];
+    }
+
+    float dy = y - s.target;
+    float dh1[NNUE_HIDDEN] = {0};
+    for (int o = 0; o < NNUE_HIDDEN2; o++) {
+        float da2 = (a2[o] > 0 && a2[o] < 1) ? dy * net.w3[o] : 0;
+        net.w3[o] -= lr * dy * h2[o];
+        if (da2 != 0) {
+            for (int i = 0; i < NNUE_HIDDEN; i++) {
+                dh1[i] += da2 * net.w2[o][i];
+                // Keep layer 2 weights inside what fits an int8 at scale 64.
+                net.w2[o][i] = min(max(net.w2[o][i] - lr * da2 * h1[i], -1.98f), 1.98f);
+            }
+            net.b2[o] -= lr * da2;
+        }
+    }
+    net.b3 -= lr * dy;
+    for (int i = 0; i < NNUE_HIDDEN; i++) {
+        float da1 = (a1[i] > 0 && a1[i] < 1) ? dh1[i] : 0;
+        if (da1 == 0) continue;
+        for (int k = 0; k < nf; k++) net.w1[f[k]][i] -= lr * da1;
+        net.b1[i] -= lr * da1;
+    }
+    return dy * dy;
+}
+
+static void quantise(const FloatNet &net, NNUEWeights &w) {
+    for (int c = 0; c < 2; c++)
+        for (int sq = 0; sq < 64; sq++)
+            for (int i = 0; i < NNUE_HIDDEN; i++)
+                w.input_weights[c][sq][i] = lround(127 * net.w1[c * 64 + sq][i]);
+    for (int i = 0; i < NNUE_HIDDEN; i++) w.input_bias[i] = lround(127 * net.b1[i]);
+    for (int o = 0; o < NNUE_HIDDEN2; o++) {
+        for (int i = 0; i < NNUE_HIDDEN; i++)
+            w.hidden_weights[o][i] = lround((1 << NNUE_SHIFT) * net.w2[o][i]);
+        w.hidden_bias[o] = lround((1 << NNUE_SHIFT) * 127 * net.b2[o]);
+        w.output_weights[o] = lround(256 * net.w3[o]);
+    }
+    w.output_bias = lround(NNUE_OUTPUT_SCALE * net.b3);
+}
+
+/*
+ * Root mean square difference between the network and getBoardScore, in
+ * getBoardScore units.
+ */
+static double rmsError(const NNUEWeights *weights, const vector<Sample> &samples) {
+    Board board;
+    board.setNetwork(weights);
+    double sum = 0;
+    for (uint i = 0; i < samples.size(); i++) {
+        board.setBitboards(samples[i].black, samples[i].white);
+        double d = board.getNNUEScore() - samples[i].target * NNUE_EVAL_SCALE;
+        sum += d * d;
+    }
+    return sqrt(sum / samples.size());
+}
+
+static int train(const char *file, int n, int epochs) {
+    vector<Sample> samples = makeSamples(n, 1);
+    vector<Sample> test = makeSamples(n / 10 + 1, 2);
+
+    mt19937 rng(3);
+    normal_distribution<float> init(0.0f, 0.1f);
+    FloatNet *net = new FloatNet;
+    for (int f = 0; f < 128; f++)
+        for (int i = 0; i < NNUE_HIDDEN; i++) net->w1[f][i] = init(rng) * 0.3f;
+    for (int i = 0; i < NNUE_HIDDEN; i++) net->b1[i] = 0.5f;
+    for (int o = 0; o < NNUE_HIDDEN2; o++) {
+        for (int i = 0; i < NNUE_HIDDEN; i++) net->w2[o][i] = init(rng) * 3;
+        net->b2[o] = 0.5f;
+        net->w3[o] = init(rng);
+    }
+    net->b3 = 0;
+
+    for (int e = 0; e < epochs; e++) {
+        shuffle(samples.begin(), samples.end(), rng);
+        float lr = 0.01f / (1 + e * 0.3f);
+        double loss = 0;
+        for (uint i = 0; i < samples.size(); i++) loss += trainStep(*net, samples[i], lr);
+        cerr << "epoch " << e + 1 << ": rms " << sqrt(loss / samples.size()) * NNUE_EVAL_SCALE << endl;
+    }
+
+    NNUEWeights *weights = new NNUEWeights;
+    quantise(*net, *weights);
+    NNUEWeights *loaded = nullptr;
+    if (!nnueSave(file, *weights) || (loaded = nnueLoad(file)) == nullptr) return 1;
+    cout << "wrote " << file << ", quantised rms error on unseen positions "
+         << rmsError(loaded, test) << " (getBoardScore rms "
+         << sqrt(inner_product(test.begin(), test.end(), test.begin(), 0.0, plus<double>(),
+                 [](const Sample &a, const Sample &b) { return (double) a.target * b.target; })
+                 / test.size()) * NNUE_EVAL_SCALE << ")" << endl;
+    delete net;
+    delete weights;
+    delete loaded;
+    return 0;
+}
+
+static double perSecond(int count, chrono::steady_clock::time_point start) {
+    return count / chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+static int bench(const char *file, int n) {
+    NNUEWeights *loaded = nnueLoad(file);
+    if (loaded == nullptr) return 1;
+    vector<Sample> samples = makeSamples(n, 4);
+    vector<Board> boards(samples.size());
+    for (uint i = 0; i < samples.size(); i++) {
+        boards[i].setBitboards(samples[i].black, samples[i].white);
+        boards[i].setNetwork(loaded);
+    }
+
+    double sink = 0;
+    auto start = chrono::steady_clock::now();
+    for (uint i = 0; i < boards.size(); i++) sink += boards[i].getBoardScore(BLACK);
+    double classic = perSecond(boards.size(), start);
+
+    start = chrono::steady_clock::now();
+    int reps = 20;
+    for (int r = 0; r < reps; r++)
+        for (uint i = 0; i < boards.size(); i++) sink += boards[i].getNNUEScore();
+    double nnue = perSecond(reps * boards.size(), start);
+
+    // Make/unmake of every legal move, with and without the accumulator.
+    double make[2];
+    for (int with = 0; with < 2; with++) {
+        for (uint i = 0; i < boards.size(); i++) boards[i].setNetwork(with ? loaded : nullptr);
+        int count = 0;
+        start = chrono::steady_clock::now();
+        for (uint i = 0; i < boards.size(); i++) {
+            for (int x = 0; x < BOARDSIZE; x++) {
+                for (int y = 0; y < BOARDSIZE; y++) {
+                    Move m(x, y);
+                    if (!boards[i].checkMove(&m, BLACK)) continue;
+                    boards[i].doMove(&m, BLACK);
+                    boards[i].undoMove(&m);
+                    count++;
+                }
+            }
+        }
+        make[with] = perSecond(count, start);
+    }
+
+    cout << "getBoardScore: " << (long long) classic << " evals/s" << endl;
+    cout << "NNUE:          " << (long long) nnue << " evals/s (" << nnue / classic << "x)" << endl;
+    cout << "checkMove + doMove + undoMove: " << (long long) make[0] << "/s without accumulator, "
+         << (long long) make[1] << "/s with" << endl;
+    cout << "rms difference from getBoardScore: " << rmsError(loaded, samples) << endl;
+    delete loaded;
+    return sink == 12345.678 ? 2 : 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc >= 3 && !strcmp(argv[1], "train")) {
+        return train(argv[2], argc >= 4 ? atoi(argv[3]) : 200000, argc >= 5 ? atoi(argv[4]) : 10);
+    }
+    if (argc >= 3 && !strcmp(argv[1], "bench")) {
+        return bench(argv[2], argc >= 4 ? atoi(argv[3]) : 20000);
+    }
+    cerr << "usage: " << argv[0] << " train <weights> [positions] [epochs]" << endl;
+    cerr << "       " << argv[0] << " bench <weights> [positions]" << endl;
+    return -1;
+}
@@ -1,18 +1,52 @@
 #include "player.hpp"
+#include "profiler.hpp"
+#include "memory.hpp"
+#include "tables.hpp"
+#include <cmath>
 
-#define HIGH 2147483647
-#define LOW -2147483646
-
-Player::Player(Side temp) {
+Player::Player(Side temp) : best_so_far(-1, -1) {
     // Will be set to true in test_minimax.cpp.
     testingMinimax = false;
     side = temp;
     board = Board();
     turns_taken = 0;
     curr_time = 0;
+    best_score = 0;
     made_moves = "";
-
-    //LoadOpeningMoves();
+    useMCTS = false;
+    useNNUE = false;
+    nnue_weights = nullptr;
+    symmetricEval = false;
+    mcts_threads = max(1, (int) thread::hardware_concurrency());
+    mcts = nullptr;
+    tt = nullptr;
+    useWatchdog = true;
+    watchdog_margin = WATCHDOG_MARGIN_MS;
+    replied = false;
+    stop_search = false;
+    searching = false;
+    book_file = "opening_moves";
+    book_loaded = false;
+    nodes = 0;
+    useProver = true;
+    prover_empties = PROVER_EMPTIES;
+    prover_share = PROVER_SHARE;
+    prover_result = PROVER_UNKNOWN;
+    solver = nullptr;
+    solver_memory = nullptr;
+
+    params.lmr = true;
+    params.lmr_min_depth = 3;
+    params.lmr_min_moves = 3;
+    params.lmr_min_empties = 14;
+    params.lmr_base = 0.5;
+    params.lmr_divisor = 2.0;
+    params.pruning = true;
+    params.futility_depth = 2;
+    params.futility_margin = 400;
+    params.razor_depth = 4;
+    params.razor_margin = 1500;
+    params.prune_min_empties = 14;
 
     if (testingMinimax)
     {
@@ -26,7 +60,14 @@ Player::Player(Side temp) {
  * Destructor for the player
  */
 Player::~Player() {
-
+    delete mcts;
+    delete tt;
+    delete solver;
+    delete nnue_weights;
+    if (solver_memory != nullptr)
+    {
+        MemoryBudget::instance().release(solver_memory);
+    }
 }
 
 /*
@@ -45,6 +86,7 @@ Player::~Player() {
 Move *Player::doMove(Move *opponentsMove, int msLeft) {
 
     curr_time = msLeft;
+    replied = false;
 
     if (opponentsMove != nullptr)
     {
@@ -53,18 +95,23 @@ Move *Player::doMove(Move *opponentsMove, int msLeft) {
         made_moves += string(c_arr);
     }
 
-    if (msLeft == -1 || !board.hasMoves(side) || board.isDone())
+    if (!board.hasMoves(side) || board.isDone())
     {
         return nullptr;
     }
 
+    allocateTables();
+
     Move *to_make = nullptr;
     string to_make_str = "";
     bool pattern_found = false;
 
+    // Play the next move of the first book line that continues the game so
+    // far.
     for (uint i = 0; i < opening_moves.size(); ++i)
     {
-        if (opening_moves[i].substr(0, made_moves.length()) != "")
+        if (opening_moves[i].length() >= made_moves.length() + 2 &&
+            opening_moves[i].compare(0, made_moves.length(), made_moves) == 0)
         {
             to_make = new Move(opening_moves[i][made_moves.length()] - 'a', opening_moves[i][made_moves.length() + 1] - '1');
 
@@ -75,12 +122,15 @@ Move *Player::doMove(Move *opponentsMove, int msLeft) {
                 pattern_found = true;
                 break;
             }
+
+            delete to_make;
+            to_make = nullptr;
         }
     }
 
     if (!pattern_found)
     {
-        Move *to_make = doABMinimaxMove();
+        Move *to_make = searchMove();
 
         if (to_make != nullptr)
         {
@@ -105,6 +155,90 @@ Move *Player::doMove(Move *opponentsMove, int msLeft) {
     return to_make;
 } 
 
+/*
+ * Runs the selected search under the watchdog, starting it off with the
+ * greedy move as best_so_far. Returns the move that was sent if the
+ * watchdog had to reply, whatever the search came up with afterwards.
+ */
+Move *Player::searchMove()
+{
+    if (!useWatchdog || curr_time <= 0)
+    {
+        return useMCTS ? doMCTSMove() : doABMinimaxMove();
+    }
+
+    Move *fallback = doNaiveMove();
+    {
+        lock_guard<mutex> guard(watchdog_lock);
+        best_so_far = *fallback;
+        searching = true;
+    }
+    delete fallback;
+
+    int ms = max(0, (int) curr_time - watchdog_margin);
+    thread watchdog(&Player::runWatchdog, this, chrono::steady_clock::now() + chrono::milliseconds(ms));
+
+    Move *m = useMCTS ? doMCTSMove() : doABMinimaxMove();
+    {
+        lock_guard<mutex> guard(watchdog_lock);
+        searching = false;
+    }
+    watchdog_cv.notify_all();
+    watchdog.join();
+    stop_search = false;
+
+    if (replied)
+    {
+        delete m;
+        m = best_so_far.copy();
+    }
+    return m;
+}
+
+/*
+ * The watchdog thread: waits until the search finishes or the deadline
+ * passes, and in the second case stops the search and sends best_so_far.
+ * best_so_far doesn't change once the reply is sent because the search
+ * stops updating it when stop_search is set.
+ */
+void Player::runWatchdog(chrono::steady_clock::time_point deadline)
+{
+    unique_lock<mutex> guard(watchdog_lock);
+    if (watchdog_cv.wait_until(guard, deadline, [this] { return !searching; }))
+    {
+        return;
+    }
+
+    stop_search = true;
+    replied = true;
+    if (onReply)
+    {
+        onReply(&best_so_far);
+    }
+}
+
+/*
+ * Records m as the best move found so far by the running search.
+ */
+void Player::setBestSoFar(Move &m)
+{
+    lock_guard<mutex> guard(watchdog_lock);
+    if (!stop_search)
+    {
+        best_so_far = Move(m.getX(), m.getY());
+    }
+}
+
+/*
+ * Name of the square (x, y) as in made_moves and opening_moves, "a1" for
+ * (0, 0).
+ */
+static string moveName(int x, int y)
+{
+    char c_arr[] = {(char) ('a' + x), (char) ('1' + y), '\0'};
+    return string(c_arr);
+}
+
 Move *Player::doNaiveMove() {
 
     Move *possible;
@@ -152,143 +286,559 @@ Move *Player::doNaiveMove() {
 
 Move *Player::doABMinimaxMove()
 {
-    Move *current_move;
-    double best_value = LOW;
-    Move *best_move = nullptr;
+    Move *proved = proveMove();
+    if (proved != nullptr)
+    {
+        return proved;
+    }
 
-    for (int i = 0; i < BOARDSIZE; ++i)
+    vector<PVLine> lines = searchMultiPV(1, getSearchDepth());
+    if (stop_search)
     {
-        for (int j = 0; j < BOARDSIZE; ++j)
+        lock_guard<mutex> guard(watchdog_lock);
+        return best_so_far.copy();
+    }
+    if (lines.empty())
+    {
+        best_score = LOW;
+        return nullptr;
+    }
+
+    best_score = lines[0].score;
+    return lines[0].move.copy();
+}
+
+/*
+ * The prover stage of the alpha-beta player. Near the end of the game it
+ * runs the exact solver with a window around zero, within prover_share of
+ * an even split of the clock over our remaining moves, or of TIMELIMIT in
+ * an untimed game. Returns a move that keeps a proved win or draw, or
+ * nullptr if the position is lost, unproved or too far from the end, in
+ * which case the heuristic search decides.
+ */
+Move *Player::proveMove()
+{
+    prover_result = PROVER_UNKNOWN;
+    int empties = BOARDSIZE * BOARDSIZE - board.countBlack() - board.countWhite();
+    if (!useProver || solver == nullptr || empties > prover_empties || curr_time == 0)
+    {
+        return nullptr;
+    }
+
+    BoardT<BOARDSIZE> b;
+    b.black = board.getBlack();
+    b.white = board.getWhite();
+    double budget = (curr_time > 0) ? curr_time / max(1, (empties + 1) / 2) : TIMELIMIT;
+    solver->setDeadline((int) (prover_share * budget));
+    int sq;
+    int result = solver->prove(b, side, &sq);
+    if (solver->aborted)
+    {
+        return nullptr;
+    }
+
+    prover_result = (result > 0) ? 1 : (result < 0) ? -1 : 0;
+    if (prover_result < 0 || sq < 0)
+    {
+        return nullptr;
+    }
+    Move m(sq % BOARDSIZE, sq / BOARDSIZE);
+    setBestSoFar(m);
+    best_score = (prover_result > 0) ? HIGH : 0;
+    return m.copy();
+}
+
+/*
+ * Allocates the tables the selected search needs from the memory budget
+ * and loads the opening book. Called once the options are set so the
+ * footprint can be reported at startup. doMove calls it again, so options
+ * changed since then still get their tables; existing ones are kept.
+ */
+void Player::allocateTables()
+{
+    if (useMCTS && mcts == nullptr)
+    {
+        mcts = new MCTS(MemoryBudget::instance().share(MEMORY_SHARE_MCTS), mcts_threads);
+        mcts->stop = &stop_search;
+        mcts->on_best = [this](Move &m) { setBestSoFar(m); };
+    }
+    if (!book_loaded)
+    {
+        LoadOpeningMoves();
+        book_loaded = true;
+    }
+    if (!useMCTS && tt == nullptr)
+    {
+        tt = new TranspositionTable(MemoryBudget::instance().share(MEMORY_SHARE_TT));
+    }
+    if (!useMCTS && useProver && solver == nullptr)
+    {
+        size_t actual;
+        solver_memory = MemoryBudget::instance().allocate("solver",
+            MemoryBudget::instance().share(MEMORY_SHARE_SOLVER), 1 << 20, &actual);
+        if (solver_memory == nullptr)
+        {
+            cerr << "solver: allocation failed, using a small heap table" << endl;
+            solver = new Solver<BOARDSIZE>(12);
+        }
+        else
+        {
+            solver = new Solver<BOARDSIZE>(solver_memory, actual);
+        }
+        solver->stop = &stop_search;
+    }
+    if (useNNUE && nnue_weights == nullptr)
+    {
+        nnue_weights = nnueLoad(nnue_file);
+        if (nnue_weights == nullptr)
+        {
+            cerr << "falling back to the standard evaluation" << endl;
+            useNNUE = false;
+        }
+    }
+    // The board may have been replaced since the last call.
+    board.setNetwork(useNNUE ? nnue_weights : nullptr);
+}
+
+/*
+ * Picks a move with Monte Carlo tree search, spending an even share of the
+ * remaining clock over the moves we still expect to make. The tree is kept
+ * between calls so the search continues under the moves actually played.
+ */
+Move *Player::doMCTSMove()
+{
+    int empties = BOARDSIZE * BOARDSIZE - board.countBlack() - board.countWhite();
+    double ms = (curr_time > 0) ? curr_time / ((empties + 1) / 2 + 2) : TIMELIMIT;
+    return mcts->search(board, side, (int) ms);
+}
+
+/*
+ * Returns the depth to search each root move to, adjusted from the base
+ * depth by how much time the previous moves have taken on average. An
+ * untimed game keeps the base depth.
+ */
+int Player::getSearchDepth()
+{
+    int d = depth;
+    if (curr_time < 0)
+    {
+        return d;
+    }
+    if (turns_taken != 0 && (TOURNEYTIME - curr_time) / turns_taken > TIMELIMIT)
+    {
+        --d;
+    }
+    if (turns_taken != 0 && (TOURNEYTIME - curr_time) / turns_taken > 2 * TIMELIMIT)
+    {
+        --d;
+    }
+    if (turns_taken != 0 && (TOURNEYTIME - curr_time) / turns_taken < TIMELIMIT / depth)
+    {
+        ++d;
+    }
+    return d;
+}
+
+/*
+ * Scores every root move to depth d and returns the best n, best first,
+ * with exact scores and principal variations. Each root move is searched
+ * with the n-th best score so far as alpha, so the others are only proved
+ * to be worse. Passes of increasing depth order the root moves for the
+ * next one and fill the transposition table, which the deeper searches and
+ * the principal variations use; there are only the root moves' own
+ * variations if there is no table. If stop_search is set the result of the
+ * last complete pass is returned, which may be nothing, and if resume is
+ * given it records where the search stopped. Called again with the same
+ * resume, n and d, the search goes on from the root move it stopped in.
+ */
+vector<PVLine> Player::searchMultiPV(int n, int d, MultiPVState *resume)
+{
+    vector<PVLine> lines;
+    // Scores of the best n moves of the current pass, highest first.
+    vector<double> top;
+    vector<PVLine> complete;
+    // Keep the parity of d: it decides who is to move at each depth.
+    int start = (d % 2 == 0) ? min(d, 2) : 1;
+    uint first = 0;
+
+    if (resume != nullptr && resume->valid && resume->n == n && resume->d == d)
+    {
+        lines = resume->lines;
+        top = resume->top;
+        complete = resume->complete;
+        start = resume->iter;
+        first = resume->k;
+    }
+    else
+    {
+        for (int i = 0; i < BOARDSIZE; ++i)
         {
-            current_move = new Move(i, j);
-            if (board.checkMove(current_move, side))
+            for (int j = 0; j < BOARDSIZE; ++j)
             {
-                board.doMove(current_move, side);
-                int d = depth;
-                if (turns_taken != 0 && (TOURNEYTIME - curr_time) / turns_taken > TIMELIMIT)
+                Move m(i, j);
+                if (board.checkMove(&m, side))
                 {
-                    --d;
+                    lines.push_back(PVLine{m, 0, ""});
                 }
-                if (turns_taken != 0 && (TOURNEYTIME - curr_time) / turns_taken > 2 * TIMELIMIT)
-                {
-                    --d;
-                }
-                if (turns_taken != 0 && (TOURNEYTIME - curr_time) / turns_taken < TIMELIMIT / depth)
+            }
+        }
+        if (lines.empty() || n <= 0)
+        {
+            return vector<PVLine>();
+        }
+
+        if (tt != nullptr)
+        {
+            tt->newSearch();
+        }
+    }
+    if (resume != nullptr)
+    {
+        resume->valid = false;
+    }
+
+    for (int iter = start; iter <= d; iter += 2)
+    {
+        for (uint k = first; k < lines.size(); ++k)
+        {
+            double alpha = ((int) top.size() < n) ? LOW : top[n - 1];
+            lines[k].score = searchRootMove(&lines[k].move, iter, alpha, HIGH);
+            if (stop_search)
+            {
+                if (resume != nullptr)
                 {
-                    ++d;
+                    *resume = MultiPVState{true, n, d, iter, k, lines, top, complete};
                 }
-                double value = getABScore(board, d, LOW, HIGH);
-                board.undoMove(current_move);
-
-                if (value > best_value)
+                lines = complete;
+                break;
+            }
+            if (lines[k].score > alpha)
+            {
+                top.insert(upper_bound(top.begin(), top.end(), lines[k].score, greater<double>()),
+                           lines[k].score);
+                top.resize(min((int) top.size(), n));
+                if (top[0] == lines[k].score)
                 {
-                    best_value = value;
-                    best_move = current_move->copy();
+                    setBestSoFar(lines[k].move);
                 }
             }
-            
-            delete current_move;
         }
+        if (stop_search)
+        {
+            break;
+        }
+
+        // A move that failed low scored at most the n-th best when it was
+        // searched, so after a stable sort the first n are exact.
+        stable_sort(lines.begin(), lines.end(), [](const PVLine &a, const PVLine &b) {
+            return a.score > b.score;
+        });
+        complete = lines;
+        top.clear();
+        first = 0;
     }
 
-    return best_move;
+    if ((int) lines.size() > n)
+    {
+        lines.erase(lines.begin() + n, lines.end());
+    }
+    for (uint k = 0; k < lines.size(); ++k)
+    {
+        Move &m = lines[k].move;
+        m.num_flipped = 0;
+        board.doMove(&m, side);
+        lines[k].pv = moveName(m.getX(), m.getY()) + getPV(board, d);
+        board.undoMove(&m);
+    }
+    return lines;
+}
+
+/*
+ * Follows the exact entries of the transposition table from b, searched to
+ * depth d, and returns the moves. Passes are left out, as in made_moves.
+ */
+string Player::getPV(Board b, int d)
+{
+    string pv = "";
+    while (d > 0 && tt != nullptr)
+    {
+        Side mover = (d % 2 != 0) ? side : ((side == WHITE) ? BLACK : WHITE);
+        if (!b.hasMoves(mover))
+        {
+            --d;
+            continue;
+        }
+
+        TTEntry entry;
+        uint64_t key = b.getHash() ^ ((mover == BLACK) ? zobrist.side : 0);
+        if (!tt->probe(key, &entry) || entry.depth != d || entry.bound != TT_EXACT ||
+            entry.move == TT_NONE)
+        {
+            break;
+        }
+
+        Move m(entry.move % BOARDSIZE, entry.move / BOARDSIZE);
+        if (!b.checkMove(&m, mover))
+        {
+            break;
+        }
+        b.doMove(&m, mover);
+        pv += moveName(m.getX(), m.getY());
+        --d;
+    }
+    return pv;
+}
+
+/*
+ * Plays the root move m on the player's board, scores the resulting position
+ * with getABScore to depth d inside the (alpha, beta) window and takes the
+ * move back. Root moves are independent of each other, which is what lets
+ * the distributed search hand them out to separate processes.
+ */
+double Player::searchRootMove(Move *m, int d, double alpha, double beta)
+{
+    m->num_flipped = 0;
+    board.doMove(m, side);
+    double value = getABScore(board, d, alpha, beta);
+    board.undoMove(m);
+    return value;
 }
 
+/*
+ * Static evaluation of b from our side's point of view, using the NNUE
+ * network if selected, getBoardScore if symmetricEval is set, and
+ * otherwise the heuristic tuned for our colour.
+ */
+double Player::evaluate(Board &b)
+{
+    if (useNNUE)
+    {
+        return (side == BLACK) ? b.getNNUEScore() : -b.getNNUEScore();
+    }
+    if (symmetricEval)
+    {
+        return b.getBoardScore(side);
+    }
+    return (side == WHITE) ? b.getBlackBoardScore() : b.getBoardScore(side);
+}
+
+/*
+ * Alpha-beta score of b searched to depth d, from our side's point of view.
+ * Odd depths are our moves (max nodes) and even depths the opponent's (min
+ * nodes); a side without a move passes and uses up a ply. Nodes searched to
+ * the same depth before are answered from the transposition table where its
+ * bound allows, and its best move is tried first otherwise. Away from the
+ * end of the game, nodes near the leaves whose static score is far outside
+ * the window are pruned and late moves are searched shallower, as set in
+ * params.
+ */
 double Player::getABScore(Board b, int d, double alpha, double beta)
 {
     if (d == 0)
     {
-        return (side == WHITE) ? b.getBlackBoardScore() : b.getBoardScore(side);
+        return evaluate(b);
     }
+    // The watchdog has replied; the caller throws the result away.
+    if (stop_search.load(memory_order_relaxed))
+    {
+        return 0;
+    }
+    ++nodes;
 
-    double value = 0;
-    double best_value = (d % 2 != 0) ? LOW : HIGH;
-    bool played = false;
+    bool maximising = (d % 2 != 0);
+    Side mover = maximising ? side : ((side == WHITE) ? BLACK : WHITE);
 
-    Move *possible_move;
-    Side opposite = (side == WHITE) ? BLACK : WHITE;
+    uint64_t key = b.getHash() ^ ((mover == BLACK) ? zobrist.side : 0);
+    int tt_move = TT_NONE;
+    TTEntry entry;
+    if (tt != nullptr && tt->probe(key, &entry))
+    {
+        if (entry.depth == d && (entry.bound == TT_EXACT ||
+            (entry.bound == TT_LOWER && entry.value >= beta) ||
+            (entry.bound == TT_UPPER && entry.value <= alpha)))
+        {
+            return entry.value;
+        }
+        tt_move = entry.move;
+    }
 
-    if (d % 2 != 0)
+    int empties = BOARDSIZE * BOARDSIZE - b.countBlack() - b.countWhite();
+    if (params.pruning && empties >= params.prune_min_empties &&
+        d <= max(params.futility_depth, params.razor_depth))
     {
-        for (int i = 0; i < BOARDSIZE; ++i)
+        // Distances are measured towards the window from the side to move:
+        // a max node needs to get above alpha, a min node below beta.
+        double sign = maximising ? 1 : -1;
+        double bound = maximising ? alpha : beta;
+        double static_score = evaluate(b);
+        double shortfall = sign * (bound - static_score);
+
+        if (d <= params.futility_depth && shortfall >= params.futility_margin * d)
         {
-            for (int j = 0; j < BOARDSIZE; ++j)
+            return static_score + sign * params.futility_margin * d;
+        }
+        if (d <= params.razor_depth && d > 2 && shortfall >= params.razor_margin)
+        {
+            double value = getABScore(b, d - 2, alpha, beta);
+            if (sign * (bound - value) >= 0)
             {
-                possible_move = new Move(i, j);
-                if (b.checkMove(possible_move, side))
-                {
-                    played = true;
+                return value;
+            }
+        }
+    }
+
+    int moves[BOARDSIZE * BOARDSIZE];
+    int num_moves = orderMoves(b, mover, d, tt_move, moves);
+    if (num_moves == 0)
+    {
+        return getABScore(b, d - 1, alpha, beta);
+    }
 
-                    b.doMove(possible_move, side);
-                    value = getABScore(b, d - 1, alpha, beta);
-                    b.undoMove(possible_move);
+    bool reduce = params.lmr && d >= params.lmr_min_depth && empties >= params.lmr_min_empties;
 
-                    best_value = max(value, best_value);
-                    alpha = max(alpha, best_value);
+    double alpha_orig = alpha;
+    double beta_orig = beta;
+    double best_value = maximising ? LOW : HIGH;
+    int best_move = TT_NONE;
 
-                    if (beta < alpha)
-                    {
-                        delete possible_move;
-                        break;
-                    }
-                }
+    for (int k = 0; k < num_moves; ++k)
+    {
+        Move m(moves[k] % BOARDSIZE, moves[k] / BOARDSIZE);
+        b.doMove(&m, mover);
 
-                delete possible_move;
+        int r = 0;
+        if (reduce && k >= params.lmr_min_moves)
+        {
+            r = 2 * (int) (params.lmr_base + log(d) * log(k + 1) / params.lmr_divisor);
+            // Keep a ply below the reduced node, with the same side to move.
+            r = min(r, (d - 2) & ~1);
+        }
+        double value;
+        if (r > 0)
+        {
+            value = getABScore(b, d - 1 - r, alpha, beta);
+            if (maximising ? value > alpha : value < beta)
+            {
+                value = getABScore(b, d - 1, alpha, beta);
             }
         }
+        else
+        {
+            value = getABScore(b, d - 1, alpha, beta);
+        }
+        b.undoMove(&m);
 
-        if (played)
+        if (maximising ? value > best_value : value < best_value)
+        {
+            best_value = value;
+            best_move = moves[k];
+        }
+        if (maximising)
         {
-            return best_value;
+            alpha = max(alpha, best_value);
         }
         else
         {
-            return getABScore(b, d - 1, alpha, beta);
+            beta = min(beta, best_value);
+        }
+
+        if (beta < alpha)
+        {
+            break;
         }
     }
-    else
+
+    if (tt != nullptr && !stop_search.load(memory_order_relaxed))
     {
-        for (int i = 0; i < BOARDSIZE; ++i)
+        int bound = (best_value <= alpha_orig) ? TT_UPPER
+                  : (best_value >= beta_orig) ? TT_LOWER : TT_EXACT;
+        tt->store(key, d, best_value, bound, best_move);
+    }
+    return best_value;
+}
+
+/*
+ * Fills moves with mover's legal moves as square numbers and returns how
+ * many there are. The table move goes first. Where late moves may be
+ * reduced, the rest follow best first by their static score, so that the
+ * reductions fall on the moves least likely to matter.
+ */
+int Player::orderMoves(Board &b, Side mover, int d, int tt_move, int *moves)
+{
+    PROFILE_SCOPE(PHASE_ORDERING);
+    int num_moves = 0;
+    for (int i = 0; i < BOARDSIZE; ++i)
+    {
+        for (int j = 0; j < BOARDSIZE; ++j)
         {
-            for (int j = 0; j < BOARDSIZE; ++j)
+            Move m(i, j);
+            if (b.checkMove(&m, mover))
             {
-                possible_move = new Move(i, j);
-                if (b.checkMove(possible_move, opposite))
-                {
-                    played = true;
-
-                    b.doMove(possible_move, opposite);
-                    value = getABScore(b, d - 1, alpha, beta);
-                    b.undoMove(possible_move);
-
-                    best_value = min(best_value, value);
-                    beta = min(beta, best_value);
-
-                    if (beta < alpha)
-                    {
-                        delete possible_move;
-                        break;
-                    }
-                }
-
-                delete possible_move;
+                moves[num_moves++] = i + BOARDSIZE * j;
             }
         }
+    }
 
-        if (played)
-        {
-            return best_value;
-        }
-        else
+    int *first = moves;
+    int *found = find(moves, moves + num_moves, tt_move);
+    if (found != moves + num_moves)
+    {
+        rotate(moves, found, found + 1);
+        ++first;
+    }
+
+    if (params.lmr && d >= params.lmr_min_depth && moves + num_moves - first > 1)
+    {
+        // Static scores are ours, so the opponent's best is the lowest.
+        double sign = (mover == side) ? -1 : 1;
+        double keys[BOARDSIZE * BOARDSIZE];
+        for (int k = 0; first + k < moves + num_moves; ++k)
         {
-            return getABScore(b, d - 1, alpha, beta);
+            Move m(first[k] % BOARDSIZE, first[k] / BOARDSIZE);
+            b.doMove(&m, mover);
+            keys[first[k]] = sign * evaluate(b);
+            b.undoMove(&m);
         }
+        stable_sort(first, moves + num_moves, [&keys](int a, int c) {
+            return keys[a] < keys[c];
+        });
     }
+    return num_moves;
 }
 
+/*
+ * Sets the field of params called name, as in SearchParams, or one of the
+ * prover settings: prover (on or off), prover_empties and prover_share.
+ * Returns false for an unknown name.
+ */
+bool Player::setSearchParam(const string &name, double value)
+{
+    if (name == "lmr") params.lmr = (value != 0);
+    else if (name == "lmr_min_depth") params.lmr_min_depth = (int) value;
+    else if (name == "lmr_min_moves") params.lmr_min_moves = (int) value;
+    else if (name == "lmr_min_empties") params.lmr_min_empties = (int) value;
+    else if (name == "lmr_base") params.lmr_base = value;
+    else if (name == "lmr_divisor") params.lmr_divisor = value;
+    else if (name == "pruning") params.pruning = (value != 0);
+    else if (name == "futility_depth") params.futility_depth = (int) value;
+    else if (name == "futility_margin") params.futility_margin = value;
+    else if (name == "razor_depth") params.razor_depth = (int) value;
+    else if (name == "razor_margin") params.razor_margin = value;
+    else if (name == "prune_min_empties") params.prune_min_empties = (int) value;
+    else if (name == "prover") useProver = (value != 0);
+    else if (name == "prover_empties") prover_empties = (int) value;
+    else if (name == "prover_share") prover_share = value;
+    else return false;
+    return true;
+}
+
+/*
+ * Reads the opening book from book_file, one line of moves per line as
+ * written by bookbuilder. A missing file just means no book.
+ */
 void Player::LoadOpeningMoves()
 {
-    ifstream file("opening_moves");
+    ifstream file(book_file);
     string str; 
     while (getline(file, str))
     {
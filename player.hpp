@@ -4,16 +4,96 @@
 
 #include "common.hpp"
 #include "board.hpp"
+#include "mcts.hpp"
+#include "transposition.hpp"
+#include "solver.hpp"
 #include <iostream>
 #include <vector>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <future>
+#include <mutex>
 #include <thread>
 #include <algorithm>
 #include <fstream>
 #include <time.h>
 
+#define HIGH 2147483647
+#define LOW -2147483646
+
+// The watchdog replies this many milliseconds before the clock runs out.
+#define WATCHDOG_MARGIN_MS 100
+
+// The win/loss/draw prover runs with this many empty squares or fewer, for
+// up to this share of the time the move may take.
+#define PROVER_EMPTIES 24
+#define PROVER_SHARE 0.5
+#define PROVER_UNKNOWN 2
+
 using namespace std;
 
+/*
+ * Selectivity of the alpha-beta search, set by name with setSearchParam.
+ *
+ * Late-move reductions search move k (counting from 1) of a node with d
+ * plies left 2 * floor(lmr_base + ln(d) ln(k) / lmr_divisor) plies
+ * shallower, and again to full depth if it turns out better than the best
+ * move so far. Reductions are even so that the same side is to move at the
+ * leaves, and they start after lmr_min_moves moves, at lmr_min_depth plies
+ * and with at least lmr_min_empties empty squares.
+ *
+ * Futility pruning gives up on a node futility_depth or fewer plies from
+ * the leaves whose static score is futility_margin per ply short of the
+ * window. Razoring, at razor_depth or fewer, checks a node razor_margin
+ * short of the window with a search two plies shallower first and gives up
+ * if that confirms it. Neither prunes with fewer than prune_min_empties
+ * empty squares, where the static score is no guide to the result.
+ */
+struct SearchParams {
+    bool lmr;
+    int lmr_min_depth;
+    int lmr_min_moves;
+    int lmr_min_empties;
+    double lmr_base;
+    double lmr_divisor;
+
+    bool pruning;
+    int futility_depth;
+    double futility_margin;
+    int razor_depth;
+    double razor_margin;
+    int prune_min_empties;
+};
+
+/*
+ * A root move with its score and principal variation, which starts with the
+ * move itself and is written like made_moves.
+ */
+struct PVLine {
+    Move move;
+    double score;
+    string pv;
+};
+
+/*
+ * Where a stopped searchMultiPV(n, d) left off, so that it can carry on: the
+ * pass and root move it was on, the root moves in the order of the pass,
+ * the best n scores so far in the pass, which give the next alpha, and the
+ * result of the last complete pass.
+ */
+struct MultiPVState {
+    bool valid = false;
+    int n;
+    int d;
+    int iter;
+    uint k;
+    vector<PVLine> lines;
+    vector<double> top;
+    vector<PVLine> complete;
+};
+
 class Player {
 public:
     Player(Side side);
@@ -22,17 +102,86 @@ public:
     Move *doMove(Move *opponentsMove, int msLeft);
     Move *doNaiveMove();
     Move *doABMinimaxMove();
+    Move *doMCTSMove();
+    Move *proveMove();
+    Move *searchMove();
+    void runWatchdog(chrono::steady_clock::time_point deadline);
+    void setBestSoFar(Move &m);
+    void allocateTables();
 
+    int getSearchDepth();
+    vector<PVLine> searchMultiPV(int n, int d, MultiPVState *resume = nullptr);
+    double searchRootMove(Move *m, int d, double alpha, double beta);
+    string getPV(Board b, int d);
+    double evaluate(Board &b);
     double getABScore(Board b, int depth, double alpha, double beta);
+    int orderMoves(Board &b, Side mover, int d, int tt_move, int *moves);
+    bool setSearchParam(const string &name, double value);
     void LoadOpeningMoves();
 
     // Flag to tell if the player is running within the test_minimax context
     bool testingMinimax;
 
+    // Search with MCTS instead of alpha-beta, using mcts_threads threads.
+    bool useMCTS;
+    int mcts_threads;
+    MCTS *mcts;
+
+    // Alpha-beta transposition table, or nullptr to search without one.
+    TranspositionTable *tt;
+
+    // Reductions and pruning in getABScore, and the nodes it has visited.
+    SearchParams params;
+    long long nodes;
+
+    // Before the alpha-beta search, with prover_empties or fewer empty
+    // squares, proveMove tries to settle the game with the exact solver in
+    // prover_share of the time the move may take. prover_result is what it
+    // found for our side: 1 for a win, 0 for a draw, -1 for a loss, or
+    // PROVER_UNKNOWN if it ran out of time or did not run.
+    bool useProver;
+    int prover_empties;
+    double prover_share;
+    int prover_result;
+    Solver<BOARDSIZE> *solver;
+    void *solver_memory;
+
+    // Evaluate leaves with the NNUE network loaded from nnue_file into
+    // nnue_weights, which board keeps its accumulator for.
+    bool useNNUE;
+    string nnue_file;
+    NNUEWeights *nnue_weights;
+
+    // Otherwise evaluate with getBoardScore for either colour, so that the
+    // two sides' scores are on one scale and negate each other, rather than
+    // with the heuristic tuned for our colour.
+    bool symmetricEval;
+
     int depth;
     int turns_taken;
     double curr_time;
 
+    // Score of the move returned by the last doABMinimaxMove.
+    double best_score;
+
+    // While a timed search runs, a watchdog thread waits for the clock to
+    // get within watchdog_margin ms of running out. If it does, it sets
+    // stop_search, which getABScore and MCTS poll, and hands best_so_far to
+    // onReply straight away; replied then tells the caller that the move
+    // doMove returns has already been sent.
+    bool useWatchdog;
+    int watchdog_margin;
+    function<void(Move *)> onReply;
+    bool replied;
+    atomic<bool> stop_search;
+    Move best_so_far;
+    bool searching;
+    mutex watchdog_lock;
+    condition_variable watchdog_cv;
+
+    // Opening book lines, loaded from book_file by allocateTables.
+    string book_file;
+    bool book_loaded;
     vector<string> opening_moves;
     string made_moves;
 
@@ -0,0 +1,79 @@
+#include "profiler.hpp"
+
+#ifdef PROFILE
+
+#include <cstdio>
+#include <cstring>
+
+thread_local ProfileState profile_state = {{}, {}, -1, 0};
+
+static const char *phase_names[NUM_PHASES] = {
+    "search (other)", "move generation", "make/unmake", "evaluation",
+    "TT probe", "ordering"
+};
+
+/*
+ * Prints a table of the time and calls per phase, either for the current
+ * move or accumulated over the game.
+ */
+void profileReport(std::ostream &out, const char *title, bool game)
+{
+    ProfileCounter *counters = game ? profile_state.game : profile_state.move;
+    uint64_t total = 0;
+    for (int i = 0; i < NUM_PHASES; ++i)
+    {
+        total += counters[i].ticks;
+    }
+
+    char line[128];
+    snprintf(line, sizeof(line), "%-16s %16s %7s %12s %10s\n",
+             title, PROFILE_UNIT, "%", "calls", "per call");
+    out << line;
+    for (int i = 0; i < NUM_PHASES; ++i)
+    {
+        ProfileCounter &c = counters[i];
+        snprintf(line, sizeof(line), "  %-14s %16llu %6.1f%% %12llu %10.1f\n",
+                 phase_names[i], (unsigned long long) c.ticks,
+                 total ? 100.0 * c.ticks / total : 0.0, (unsigned long long) c.calls,
+                 c.calls ? (double) c.ticks / c.calls : 0.0);
+        out << line;
+    }
+    snprintf(line, sizeof(line), "  %-14s %16llu\n", "total", (unsigned long long) total);
+    out << line;
+}
+
+/*
+ * Reports the move just played, adds it to the game totals and starts
+ * counting the next move from zero.
+ */
+void profileEndMove(std::ostream &out, int move_number)
+{
+    char title[32];
+    snprintf(title, sizeof(title), "move %d", move_number);
+    profileReport(out, title, false);
+
+    for (int i = 0; i < NUM_PHASES; ++i)
+    {
+        profile_state.game[i].ticks += profile_state.move[i].ticks;
+        profile_state.game[i].calls += profile_state.move[i].calls;
+    }
+    memset(profile_state.move, 0, sizeof(profile_state.move));
+}
+
+/*
+ * Reports the game so far, including a move that was not ended on its own,
+ * and starts counting the next game from zero.
+ */
+void profileEndGame(std::ostream &out)
+{
+    for (int i = 0; i < NUM_PHASES; ++i)
+    {
+        profile_state.game[i].ticks += profile_state.move[i].ticks;
+        profile_state.game[i].calls += profile_state.move[i].calls;
+    }
+    memset(profile_state.move, 0, sizeof(profile_state.move));
+    profileReport(out, "game", true);
+    memset(profile_state.game, 0, sizeof(profile_state.game));
+}
+
+#endif
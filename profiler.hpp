@@ -0,0 +1,103 @@
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+/*
+ * Lightweight per-phase profiler for the search hot path. Build with
+ * "make PROFILE=1" to enable it; otherwise every macro below expands to
+ * nothing and the engine carries no instrumentation at all.
+ *
+ * PROFILE_SCOPE(phase) charges the time until the end of the enclosing block
+ * to phase. Time is exclusive: while a nested scope runs, its parent's clock
+ * is stopped, so the phases of a report add up to the measured total.
+ */
+
+enum ProfilePhase {
+    PHASE_SEARCH,
+    PHASE_MOVEGEN,
+    PHASE_MAKE,
+    PHASE_EVAL,
+    PHASE_TT,
+    PHASE_ORDERING,
+    NUM_PHASES
+};
+
+#ifdef PROFILE
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILE_UNIT "cycles"
+static inline uint64_t profileClock() { return __rdtsc(); }
+#else
+#define PROFILE_UNIT "ns"
+static inline uint64_t profileClock()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+struct ProfileCounter {
+    uint64_t ticks;
+    uint64_t calls;
+};
+
+struct ProfileState {
+    ProfileCounter move[NUM_PHASES];
+    ProfileCounter game[NUM_PHASES];
+    int current;
+    uint64_t started;
+};
+
+extern thread_local ProfileState profile_state;
+
+class ProfileScope {
+public:
+    ProfileScope(int phase)
+    {
+        uint64_t now = profileClock();
+        if (profile_state.current >= 0)
+        {
+            profile_state.move[profile_state.current].ticks += now - profile_state.started;
+        }
+        parent = profile_state.current;
+        profile_state.current = phase;
+        profile_state.started = now;
+    }
+
+    ~ProfileScope()
+    {
+        uint64_t now = profileClock();
+        ProfileCounter &counter = profile_state.move[profile_state.current];
+        counter.ticks += now - profile_state.started;
+        counter.calls += 1;
+        profile_state.current = parent;
+        profile_state.started = now;
+    }
+
+private:
+    int parent;
+};
+
+void profileReport(std::ostream &out, const char *title, bool game);
+void profileEndMove(std::ostream &out, int move_number);
+void profileEndGame(std::ostream &out);
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#define PROFILE_SCOPE(phase) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(phase)
+#define PROFILE_END_MOVE(out, n) profileEndMove(out, n)
+#define PROFILE_END_GAME(out) profileEndGame(out)
+
+#else
+
+#define PROFILE_SCOPE(phase)
+#define PROFILE_END_MOVE(out, n)
+#define PROFILE_END_GAME(out)
+
+#endif
+
+#endif
@@ -0,0 +1,418 @@
+#include "scheduler.hpp"
+#include <algorithm>
+#include <cmath>
+
+static const char *class_names[NUM_JOB_CLASSES] = {"interactive", "batch"};
+
+JobScheduler::JobScheduler(int threads, bool preempt)
+{
+    this->preempt = preempt;
+    next_worker = 0;
+    unfinished = 0;
+    idle = 0;
+    stopping = false;
+    preemptions = 0;
+    steals = 0;
+    for (int c = 0; c < NUM_JOB_CLASSES; ++c)
+    {
+        waiting[c] = 0;
+        active[c] = 0;
+        completed[c] = 0;
+    }
+
+    threads = max(threads, 1);
+    for (int i = 0; i < threads; ++i)
+    {
+        workers.push_back(new Worker());
+    }
+    for (int i = 0; i < threads; ++i)
+    {
+        this->threads.push_back(thread(&JobScheduler::workerLoop, this, i));
+    }
+    if (preempt)
+    {
+        preempter = thread(&JobScheduler::preemptLoop, this);
+    }
+}
+
+/*
+ * Stops the workers, cutting short the searches they are running.
+ * Unfinished jobs are dropped without being called back, so callers that
+ * want them all wait() first.
+ */
+JobScheduler::~JobScheduler()
+{
+    {
+        lock_guard<mutex> guard(wake_lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    preempt_wake.notify_all();
+    if (preempter.joinable())
+    {
+        preempter.join();
+    }
+    for (uint i = 0; i < workers.size(); ++i)
+    {
+        lock_guard<mutex> guard(workers[i]->lock);
+        if (workers[i]->current != nullptr)
+        {
+            workers[i]->current->player->stop_search = true;
+        }
+    }
+    for (uint i = 0; i < threads.size(); ++i)
+    {
+        threads[i].join();
+    }
+    for (uint i = 0; i < workers.size(); ++i)
+    {
+        for (int c = 0; c < NUM_JOB_CLASSES; ++c)
+        {
+            for (AnalysisJob *job : workers[i]->queues[c])
+            {
+                delete job->player;
+                job->player = nullptr;
+            }
+        }
+        delete workers[i];
+    }
+}
+
+/*
+ * Queues job on the next worker in turn. The job must stay alive until its
+ * done callback has been called.
+ */
+void JobScheduler::submit(AnalysisJob *job)
+{
+    job->submitted = chrono::steady_clock::now();
+    job->result.clear();
+    job->depth_reached = 0;
+    job->preemptions = 0;
+    job->player = nullptr;
+    // Keep the parity of depth, as searchMultiPV does.
+    job->next_depth = (job->depth % 2 == 0) ? min(job->depth, 2) : 1;
+
+    {
+        lock_guard<mutex> guard(wake_lock);
+        ++unfinished;
+    }
+    Worker *w = workers[next_worker++ % workers.size()];
+    {
+        lock_guard<mutex> guard(w->lock);
+        w->queues[job->priority].push_back(job);
+    }
+    ++waiting[job->priority];
+
+    // Taking the lock orders the notification after a worker's or the
+    // preempter's last look at waiting, so neither can go to sleep on a job
+    // it missed.
+    {
+        lock_guard<mutex> guard(wake_lock);
+    }
+    wake.notify_one();
+    if (job->priority == JOB_INTERACTIVE)
+    {
+        preempt_wake.notify_one();
+    }
+}
+
+/*
+ * Blocks until every submitted job has finished.
+ */
+void JobScheduler::wait()
+{
+    unique_lock<mutex> guard(wake_lock);
+    all_done.wait(guard, [this]() { return unfinished == 0; });
+}
+
+int JobScheduler::queued(JobClass priority)
+{
+    return waiting[priority];
+}
+
+int JobScheduler::running(JobClass priority)
+{
+    return active[priority];
+}
+
+/*
+ * The p-th percentile (0-100) of the latest latencies of the class, from
+ * submission to completion, in milliseconds; 0 if none have finished.
+ */
+double JobScheduler::latencyPercentile(JobClass priority, double p)
+{
+    vector<double> sorted;
+    {
+        lock_guard<mutex> guard(stats_lock);
+        sorted.assign(latencies[priority].begin(), latencies[priority].end());
+    }
+    if (sorted.empty())
+    {
+        return 0;
+    }
+    sort(sorted.begin(), sorted.end());
+    int rank = (int) ceil(p / 100 * sorted.size()) - 1;
+    return sorted[min(max(rank, 0), (int) sorted.size() - 1)];
+}
+
+/*
+ * Prints the queue depth, running jobs and latency percentiles of each
+ * class, and how often batch jobs were preempted and jobs stolen.
+ */
+void JobScheduler::report(ostream &out)
+{
+    for (int c = 0; c < NUM_JOB_CLASSES; ++c)
+    {
+        JobClass priority = (JobClass) c;
+        long done;
+        {
+            lock_guard<mutex> guard(stats_lock);
+            done = completed[c];
+        }
+        out << class_names[c] << ": " << queued(priority) << " queued, " << running(priority)
+            << " running, " << done << " done, latency p50 " << latencyPercentile(priority, 50)
+            << " ms, p90 " << latencyPercentile(priority, 90) << " ms, p99 "
+            << latencyPercentile(priority, 99) << " ms, max " << latencyPercentile(priority, 100)
+            << " ms" << endl;
+    }
+    lock_guard<mutex> guard(stats_lock);
+    out << preemptions << " preemptions, " << steals << " steals" << endl;
+}
+
+/*
+ * The next job for worker self: interactive before batch, and within a
+ * class the front of its own deque before the back of another worker's.
+ * Returns nullptr if every deque is empty.
+ */
+AnalysisJob *JobScheduler::take(int self)
+{
+    int n = workers.size();
+    for (int c = 0; c < NUM_JOB_CLASSES; ++c)
+    {
+        if (waiting[c] == 0)
+        {
+            continue;
+        }
+        for (int k = 0; k < n; ++k)
+        {
+            Worker *w = workers[(self + k) % n];
+            AnalysisJob *job = nullptr;
+            {
+                lock_guard<mutex> guard(w->lock);
+                deque<AnalysisJob *> &q = w->queues[c];
+                if (q.empty())
+                {
+                    continue;
+                }
+                if (k == 0)
+                {
+                    job = q.front();
+                    q.pop_front();
+                }
+                else
+                {
+                    job = q.back();
+                    q.pop_back();
+                }
+            }
+            --waiting[c];
+            if (k != 0)
+            {
+                lock_guard<mutex> guard(stats_lock);
+                ++steals;
+            }
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+/*
+ * The preempter thread. While interactive jobs wait and no worker is idle,
+ * it stops running batch jobs, one per waiting interactive job, longest
+ * running first, and each only once it has had JOB_MIN_SLICE_MS since it
+ * started or resumed.
+ */
+void JobScheduler::preemptLoop()
+{
+    chrono::milliseconds slice(JOB_MIN_SLICE_MS);
+    unique_lock<mutex> guard(wake_lock);
+    while (!stopping)
+    {
+        if (waiting[JOB_INTERACTIVE] == 0 || idle > 0)
+        {
+            preempt_wake.wait(guard);
+            continue;
+        }
+
+        int stopped = 0;
+        Worker *oldest = nullptr;
+        AnalysisJob *victim = nullptr;
+        chrono::steady_clock::time_point started;
+        for (uint i = 0; i < workers.size(); ++i)
+        {
+            lock_guard<mutex> worker_guard(workers[i]->lock);
+            AnalysisJob *job = workers[i]->current;
+            if (job == nullptr || job->priority != JOB_BATCH)
+            {
+                continue;
+            }
+            if (job->player->stop_search)
+            {
+                ++stopped;
+            }
+            else if (oldest == nullptr || job->slice_start < started)
+            {
+                oldest = workers[i];
+                victim = job;
+                started = job->slice_start;
+            }
+        }
+
+        // Nothing to stop yet: look again once a batch job has had its
+        // slice, or something has changed.
+        if (oldest == nullptr || stopped >= waiting[JOB_INTERACTIVE])
+        {
+            preempt_wake.wait_for(guard, slice);
+            continue;
+        }
+        if (chrono::steady_clock::now() < started + slice)
+        {
+            preempt_wake.wait_until(guard, started + slice);
+            continue;
+        }
+
+        lock_guard<mutex> worker_guard(oldest->lock);
+        if (oldest->current == victim)
+        {
+            victim->player->stop_search = true;
+        }
+    }
+}
+
+/*
+ * Searches job one iteration deeper. Returns true once it has reached its
+ * depth or there is nothing to search, and false if there is more to do or
+ * the iteration was stopped, in which case the results are left alone and
+ * search_state says where to go on from.
+ */
+bool JobScheduler::runIteration(AnalysisJob *job)
+{
+    int d = job->next_depth;
+    vector<PVLine> lines = job->player->searchMultiPV(job->lines, d, &job->search_state);
+    if (job->player->stop_search)
+    {
+        return false;
+    }
+    job->result = lines;
+    job->depth_reached = d;
+    job->next_depth = d + 2;
+    return lines.empty() || d >= job->depth;
+}
+
+void JobScheduler::finish(AnalysisJob *job)
+{
+    delete job->player;
+    job->player = nullptr;
+    job->finished = chrono::steady_clock::now();
+    double ms = chrono::duration<double, milli>(job->finished - job->submitted).count();
+    {
+        lock_guard<mutex> guard(stats_lock);
+        deque<double> &l = latencies[job->priority];
+        l.push_back(ms);
+        if (l.size() > JOB_LATENCY_WINDOW)
+        {
+            l.pop_front();
+        }
+        ++completed[job->priority];
+    }
+
+    // The callback may free the job, so it is the last thing to touch it.
+    if (job->done)
+    {
+        job->done(job);
+    }
+    {
+        lock_guard<mutex> guard(wake_lock);
+        --unfinished;
+    }
+    all_done.notify_all();
+}
+
+void JobScheduler::workerLoop(int self)
+{
+    while (!stopping)
+    {
+        AnalysisJob *job = take(self);
+        if (job == nullptr)
+        {
+            unique_lock<mutex> guard(wake_lock);
+            if (stopping)
+            {
+                return;
+            }
+            if (waiting[JOB_INTERACTIVE] + waiting[JOB_BATCH] == 0)
+            {
+                ++idle;
+                wake.wait(guard);
+                --idle;
+            }
+            continue;
+        }
+
+        if (job->player == nullptr)
+        {
+            job->player = new Player(job->side);
+            job->player->board = job->board;
+            job->player->tt = new TranspositionTable(JOB_TT_BYTES);
+        }
+        job->player->stop_search = false;
+        job->slice_start = chrono::steady_clock::now();
+        {
+            lock_guard<mutex> guard(workers[self]->lock);
+            workers[self]->current = job;
+        }
+        preempt_wake.notify_one();
+
+        JobClass priority = job->priority;
+        ++active[priority];
+        bool complete;
+        while (!(complete = runIteration(job)) && !job->player->stop_search && !stopping)
+        {
+            if (preempt && priority == JOB_BATCH && waiting[JOB_INTERACTIVE] > 0)
+            {
+                break;
+            }
+        }
+        {
+            lock_guard<mutex> guard(workers[self]->lock);
+            workers[self]->current = nullptr;
+        }
+        --active[priority];
+        if (stopping && !complete)
+        {
+            delete job->player;
+            job->player = nullptr;
+            continue;
+        }
+
+        if (complete)
+        {
+            finish(job);
+            continue;
+        }
+
+        // Preempted: the job resumes from its next iteration, ahead of the
+        // batch jobs that have not started.
+        ++job->preemptions;
+        {
+            lock_guard<mutex> guard(stats_lock);
+            ++preemptions;
+        }
+        {
+            lock_guard<mutex> guard(workers[self]->lock);
+            workers[self]->queues[JOB_BATCH].push_front(job);
+        }
+        ++waiting[JOB_BATCH];
+    }
+}
@@ -0,0 +1,132 @@
+#ifndef __SCHEDULER_H__
+#define __SCHEDULER_H__
+
+#include "player.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Transposition table per running or preempted job.
+#define JOB_TT_BYTES (4 << 20)
+
+// Latencies kept per class for the percentiles; older ones are dropped.
+#define JOB_LATENCY_WINDOW 100000
+
+// Time a batch job runs after starting or resuming before it may be
+// stopped for an interactive one.
+#define JOB_MIN_SLICE_MS 100
+
+enum JobClass {
+    JOB_INTERACTIVE,
+    JOB_BATCH,
+    NUM_JOB_CLASSES
+};
+
+/*
+ * A multi-PV analysis of one position to a given depth. The caller fills in
+ * the request and done, and owns the job; done is called on a worker thread
+ * once result holds the lines of the deepest search.
+ *
+ * The search deepens two plies at a time. Between iterations the job keeps
+ * its Player, whose transposition table holds everything searched so far,
+ * and next_depth, so that a preempted job resumes where it stopped. An
+ * iteration cut short also keeps the root moves it had finished in
+ * search_state, and goes on from the one it was stopped in.
+ */
+struct AnalysisJob {
+    JobClass priority;
+    Board board;
+    Side side;
+    int depth;
+    int lines;
+    function<void(AnalysisJob *)> done;
+
+    vector<PVLine> result;
+    int depth_reached;
+    int preemptions;
+    chrono::steady_clock::time_point submitted;
+    chrono::steady_clock::time_point finished;
+
+    Player *player;
+    int next_depth;
+    MultiPVState search_state;
+    chrono::steady_clock::time_point slice_start;
+};
+
+/*
+ * Runs analysis jobs on a fixed set of worker threads. Every worker has a
+ * deque per class: submissions are spread over the workers, a worker takes
+ * from the front of its own deques and steals from the back of the others'
+ * when its own are empty, and interactive jobs always go before batch ones.
+ *
+ * With preemption, a batch job yields between iterations while interactive
+ * jobs are waiting, and while no worker is idle for them a preempter thread
+ * stops running batch jobs through their Players' stop_search, each once it
+ * has run JOB_MIN_SLICE_MS, so that it still gets somewhere under a steady
+ * stream of queries. Either way the job goes back to the front of its
+ * worker's batch deque with its state, to be resumed once they have been
+ * served.
+ */
+class JobScheduler {
+public:
+    JobScheduler(int threads, bool preempt);
+    ~JobScheduler();
+
+    void submit(AnalysisJob *job);
+    void wait();
+
+    int queued(JobClass priority);
+    int running(JobClass priority);
+    double latencyPercentile(JobClass priority, double p);
+    void report(ostream &out);
+
+private:
+    struct Worker {
+        deque<AnalysisJob *> queues[NUM_JOB_CLASSES];
+        // The job being run, under lock.
+        AnalysisJob *current = nullptr;
+        mutex lock;
+    };
+
+    void workerLoop(int self);
+    AnalysisJob *take(int self);
+    void preemptLoop();
+    bool runIteration(AnalysisJob *job);
+    void finish(AnalysisJob *job);
+
+    bool preempt;
+    vector<Worker *> workers;
+    vector<thread> threads;
+    thread preempter;
+    atomic<unsigned> next_worker;
+
+    // Jobs waiting in the deques, and running, per class, jobs not yet
+    // finished and workers asleep. wake is signalled under wake_lock
+    // whenever work arrives, and preempt_wake when interactive work does.
+    atomic<int> waiting[NUM_JOB_CLASSES];
+    atomic<int> active[NUM_JOB_CLASSES];
+    int unfinished;
+    int idle;
+    atomic<bool> stopping;
+    mutex wake_lock;
+    condition_variable wake;
+    condition_variable all_done;
+    condition_variable preempt_wake;
+
+    // Completion statistics, in milliseconds from submission.
+    mutex stats_lock;
+    deque<double> latencies[NUM_JOB_CLASSES];
+    long completed[NUM_JOB_CLASSES];
+    long preemptions;
+    long steals;
+};
+
+#endif
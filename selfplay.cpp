@@ -0,0 +1,177 @@
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include "player.hpp"
+#include "profiler.hpp"
+using namespace std;
+
+/*
+ * Plays engine configurations against each other inside one process, with a
+ * game clock per side in the same way as the Java OthelloGame, and reports
+ * the results. Colours alternate between games.
+ *
+ * usage: selfplay [-g games] [-t ms] [-r random_plies] [-s seed] engineA engineB
+ *
+ * An engine is a comma separated list of options:
+ *   ab          alpha-beta search (the default)
+ *   mcts        Monte Carlo tree search
+ *   depth=N     alpha-beta base depth
+ *   threads=N   MCTS threads
+ *   nnue=FILE   evaluate with the NNUE network in FILE
+ *   NAME=VALUE  alpha-beta search parameter, as in Player::setSearchParam
+ *               (lmr=0 and pruning=0 turn the selective search off,
+ *               prover=0 the endgame prover)
+ */
+
+static Player *makePlayer(string spec, Side side) {
+    Player *player = new Player(side);
+    stringstream ss(spec);
+    string option;
+    while (getline(ss, option, ',')) {
+        if (option == "ab") {
+            player->useMCTS = false;
+        } else if (option == "mcts") {
+            player->useMCTS = true;
+        } else if (option.compare(0, 6, "depth=") == 0) {
+            player->depth = atoi(option.c_str() + 6);
+        } else if (option.compare(0, 8, "threads=") == 0) {
+            player->mcts_threads = atoi(option.c_str() + 8);
+        } else if (option.compare(0, 5, "nnue=") == 0) {
+            player->useNNUE = true;
+            player->nnue_file = option.substr(5);
+        } else if (option.find('=') != string::npos &&
+                   player->setSearchParam(option.substr(0, option.find('=')),
+                                          atof(option.c_str() + option.find('=') + 1))) {
+        } else {
+            cerr << "unknown engine option " << option << endl;
+            exit(-1);
+        }
+    }
+    player->allocateTables();
+    return player;
+}
+
+/*
+ * Plays one game and returns black's disc lead at the end. A side that runs
+ * out of time or plays an illegal move loses with a score of -64.
+ */
+static int playGame(string black_spec, string white_spec, int ms, int random_plies,
+                    double *black_ms, double *white_ms) {
+    Player *players[2] = {makePlayer(white_spec, WHITE), makePlayer(black_spec, BLACK)};
+    double used[2] = {0, 0};
+    Board board;
+    Side turn = BLACK;
+    string history;
+
+    for (int i = 0; i < random_plies && !board.isDone(); i++) {
+        vector<Move> moves;
+        for (int x = 0; x < BOARDSIZE; x++) {
+            for (int y = 0; y < BOARDSIZE; y++) {
+                Move m(x, y);
+                if (board.checkMove(&m, turn)) moves.push_back(m);
+            }
+        }
+        if (!moves.empty()) {
+            Move &m = moves[rand() % moves.size()];
+            board.doMove(&m, turn);
+            history += string(1, 'a' + m.getX()) + string(1, '1' + m.getY());
+        }
+        turn = (turn == BLACK) ? WHITE : BLACK;
+    }
+    // The book is looked up by the moves so far, so they include the
+    // random ones.
+    for (int i = 0; i < 2; i++) {
+        players[i]->board = board;
+        players[i]->made_moves = history;
+    }
+
+    Move *last = nullptr;
+    int result = 0;
+    bool forfeit = false;
+    while (!board.isDone()) {
+        Player *player = players[turn];
+        int ms_left = (int) (ms - used[turn]);
+
+        auto start = chrono::steady_clock::now();
+        Move *m = player->doMove(last, ms_left);
+        used[turn] += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        if (used[turn] > ms || !board.checkMove(m, turn)) {
+            cerr << ((turn == BLACK) ? "black" : "white")
+                 << (used[turn] > ms ? " ran out of time" : " made an illegal move") << endl;
+            result = (turn == BLACK) ? -64 : 64;
+            forfeit = true;
+            delete m;
+            break;
+        }
+
+        board.doMove(m, turn);
+        delete last;
+        last = m;
+        turn = (turn == BLACK) ? WHITE : BLACK;
+    }
+
+    if (!forfeit) {
+        result = board.countBlack() - board.countWhite();
+    }
+
+    // One report for both engines, which share this thread.
+    PROFILE_END_GAME(cerr);
+    delete last;
+    delete players[0];
+    delete players[1];
+    *black_ms = used[BLACK];
+    *white_ms = used[WHITE];
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    int games = 2;
+    int ms = 60000;
+    int random_plies = 0;
+    unsigned seed = 1;
+    vector<string> engines;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-g") && i + 1 < argc) games = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc) ms = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-r") && i + 1 < argc) random_plies = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-s") && i + 1 < argc) seed = atoi(argv[++i]);
+        else engines.push_back(argv[i]);
+    }
+    if (engines.size() != 2) {
+        cerr << "usage: " << argv[0] << " [-g games] [-t ms] [-r random_plies] [-s seed]"
+             << " engineA engineB" << endl;
+        exit(-1);
+    }
+
+    int wins = 0, losses = 0, draws = 0;
+    double a_ms = 0, b_ms = 0;
+    for (int g = 0; g < games; g++) {
+        // Both colour assignments see the same random opening.
+        srand(seed + g / 2);
+        bool a_black = (g % 2 == 0);
+        double black_ms, white_ms;
+        int result = playGame(engines[a_black ? 0 : 1], engines[a_black ? 1 : 0],
+                              ms, random_plies, &black_ms, &white_ms);
+        int a_result = a_black ? result : -result;
+        a_ms += a_black ? black_ms : white_ms;
+        b_ms += a_black ? white_ms : black_ms;
+
+        if (a_result > 0) wins++;
+        else if (a_result < 0) losses++;
+        else draws++;
+
+        cout << "game " << g + 1 << ": " << engines[0] << " as "
+             << (a_black ? "black" : "white") << " " << (a_result > 0 ? "+" : "")
+             << a_result << " (black " << (int) black_ms << " ms, white "
+             << (int) white_ms << " ms)" << endl;
+    }
+
+    cout << engines[0] << " vs " << engines[1] << ": +" << wins << " -" << losses
+         << " =" << draws << ", time used " << (int) a_ms << " / " << (int) b_ms
+         << " ms" << endl;
+    return 0;
+}
@@ -0,0 +1,662 @@
+#ifndef __SOLVER_H__
+#define __SOLVER_H__
+
+#include <atomic>
+#include <chrono>
+#include "boardt.hpp"
+
+using namespace std;
+
+/*
+ * Size-generic searches on BoardT<N>: perft, an exact endgame solver and a
+ * fixed-depth alpha-beta player for the small-board matches. Positions are
+ * passed as P (side to move) and O (opponent), and every score is from the
+ * side to move's point of view.
+ */
+
+/*
+ * Number of positions depth plies from b with side to move. A pass counts
+ * as a ply, and a finished game as one position however much depth is left.
+ */
+template <int N>
+long long perft(const BoardT<N> &b, Side side, int depth)
+{
+    if (depth == 0)
+    {
+        return 1;
+    }
+    Side other = (side == BLACK) ? WHITE : BLACK;
+    typename BoardT<N>::Bits moves = b.moves(side);
+    if (moves == 0)
+    {
+        return b.hasMoves(other) ? perft(b, other, depth - 1) : 1;
+    }
+
+    long long total = 0;
+    while (moves)
+    {
+        int sq = BoardT<N>::first(moves);
+        moves &= moves - 1;
+        BoardT<N> next = b;
+        next.doMove(sq, side);
+        total += perft(next, other, depth - 1);
+    }
+    return total;
+}
+
+/*
+ * Exact solver: negamax alpha-beta over final disc differences (empty
+ * squares go to the winner), with principal variation search, a
+ * transposition table of bounds and fastest-first move ordering away from
+ * the last few empties.
+ */
+template <int N>
+class Solver
+{
+public:
+    typedef typename BoardT<N>::Bits Bits;
+
+    // Below this many empties, moves are tried in square order and the
+    // table is left alone: the bookkeeping costs more than it saves.
+    static const int SHALLOW = 6;
+
+    // Above this many empties, moves are ordered by a shallow heuristic
+    // search rather than by mobility alone.
+    static const int SORT_SEARCH = 12;
+
+    // For this many plies from the start, symmetric positions are searched
+    // through one move of each mirrored pair.
+    static const int SYMMETRY_PLIES = 6;
+
+    // Interior nodes between looks at the clock.
+    static const int CHECK_INTERVAL = 4096;
+
+    long long nodes;
+
+    // A search gives up once the clock passes deadline, if limited is set,
+    // or once *stop is set, if stop is given. aborted then says that the
+    // result is meaningless; it stays set until the next setDeadline.
+    bool limited;
+    chrono::steady_clock::time_point deadline;
+    const atomic<bool> *stop;
+    bool aborted;
+
+    /*
+     * A solver with a table of 2^table_bits entries on the heap.
+     */
+    Solver(int table_bits = 20)
+    {
+        table = new Entry[(size_t) 1 << table_bits]();
+        owned = true;
+        mask = ((size_t) 1 << table_bits) - 1;
+        init();
+    }
+
+    /*
+     * A solver whose table lives in bytes of zeroed memory owned by the
+     * caller, such as a block from MemoryBudget.
+     */
+    Solver(void *memory, size_t bytes)
+    {
+        table = (Entry *) memory;
+        owned = false;
+        size_t count = 2;
+        while (2 * count * sizeof(Entry) <= bytes)
+        {
+            count *= 2;
+        }
+        mask = count - 1;
+        init();
+    }
+
+    ~Solver()
+    {
+        if (owned)
+        {
+            delete[] table;
+        }
+    }
+
+    /*
+     * Limits the following searches to ms milliseconds from now, or lifts
+     * the limit if ms is negative.
+     */
+    void setDeadline(int ms)
+    {
+        limited = (ms >= 0);
+        deadline = chrono::steady_clock::now() + chrono::milliseconds(max(ms, 0));
+        aborted = false;
+        next_check = nodes;
+    }
+
+    /*
+     * Win, loss or draw for side to move in b under perfect play: the sign
+     * of the score, proved with a window around zero, which costs much less
+     * than the exact score. The value itself is only a bound beyond -1 and
+     * 1. If best is given it is set to a move that achieves the result.
+     */
+    int prove(const BoardT<N> &b, Side side, int *best = nullptr)
+    {
+        Bits P = b.stones(side);
+        Bits O = b.stones((side == BLACK) ? WHITE : BLACK);
+        return search(P, O, -1, 1, false, best);
+    }
+
+    /*
+     * Score of b with side to move under perfect play. If best is given it
+     * is set to the best square, or -1 for a pass or a finished game.
+     */
+    int solve(const BoardT<N> &b, Side side, int *best = nullptr)
+    {
+        Bits P = b.stones(side);
+        Bits O = b.stones((side == BLACK) ? WHITE : BLACK);
+
+        // MTD(f): null-window searches close in on the score from a guess
+        // of a draw, each one reusing the bounds the last left in the table.
+        int lower = -BoardT<N>::SQUARES;
+        int upper = BoardT<N>::SQUARES;
+        int guess = 0;
+        while (lower < upper && !aborted)
+        {
+            int beta = (guess == lower) ? guess + 1 : guess;
+            guess = search(P, O, beta - 1, beta, false);
+            if (guess < beta)
+            {
+                upper = guess;
+            }
+            else
+            {
+                lower = guess;
+            }
+        }
+        if (best != nullptr && !aborted)
+        {
+            search(P, O, lower - 1, lower + 1, false, best);
+        }
+        return lower;
+    }
+
+    /*
+     * Score of P to move against O inside the window (alpha, beta): exact if
+     * it falls inside, otherwise a bound on the side it falls.
+     */
+    int search(Bits P, Bits O, int alpha, int beta, bool passed, int *best = nullptr)
+    {
+        int empties = BoardT<N>::SQUARES - BoardT<N>::count(P | O);
+        if (empties <= SHALLOW && best == nullptr)
+        {
+            return searchShallow(P, O, empties, alpha, beta, passed);
+        }
+
+        ++nodes;
+        if (best != nullptr)
+        {
+            *best = -1;
+        }
+        if (nodes >= next_check)
+        {
+            next_check = nodes + CHECK_INTERVAL;
+            if ((limited && chrono::steady_clock::now() > deadline) ||
+                (stop != nullptr && stop->load(memory_order_relaxed)))
+            {
+                aborted = true;
+            }
+        }
+        if (aborted)
+        {
+            return 0;
+        }
+
+        Bits moves = BoardT<N>::moves(P, O);
+        if (moves == 0)
+        {
+            if (passed)
+            {
+                return finalScore(P, O);
+            }
+            return -search(O, P, -beta, -alpha, true);
+        }
+
+        // The root, which has to report a move, uses the table for ordering
+        // only.
+        Entry *e = probe(P, O);
+        int tt_move = -1;
+        if (e != nullptr)
+        {
+            if (best == nullptr)
+            {
+                if (e->lower >= beta)
+                {
+                    return e->lower;
+                }
+                if (e->upper <= alpha)
+                {
+                    return e->upper;
+                }
+                if (e->lower == e->upper)
+                {
+                    return e->lower;
+                }
+                alpha = max(alpha, (int) e->lower);
+                beta = min(beta, (int) e->upper);
+            }
+            tt_move = e->move;
+        }
+
+        // Near the start the position is often symmetric, and moves that
+        // mirror each other lead to the same game: keep one of each.
+        if (empties > BoardT<N>::SQUARES - 4 - SYMMETRY_PLIES)
+        {
+            moves = uniqueMoves(P, O, moves);
+        }
+
+        // Table move first, then the moves that leave the opponent the
+        // fewest replies, counting a corner twice. A child whose stored
+        // bound already refutes this position cuts it off before any search.
+        const Bits corners = BoardT<N>::bit(0) | BoardT<N>::bit(N - 1) |
+                             BoardT<N>::bit(N * (N - 1)) | BoardT<N>::bit(N * N - 1);
+        int order[BoardT<N>::SQUARES];
+        int keys[BoardT<N>::SQUARES];
+        int n = 0;
+        while (moves)
+        {
+            int sq = BoardT<N>::first(moves);
+            moves &= moves - 1;
+            Bits f = BoardT<N>::flips(P, O, sq);
+            Bits next_O = O & ~f;
+            Bits next_P = P | f | BoardT<N>::bit(sq);
+
+            Entry *child = (empties > SHALLOW + 1) ? probe(next_O, next_P) : nullptr;
+            if (child != nullptr && -child->upper >= beta && best == nullptr)
+            {
+                store(P, O, empties, -child->upper, BoardT<N>::SQUARES, sq);
+                return -child->upper;
+            }
+
+            Bits replies = BoardT<N>::moves(next_O, next_P);
+            int key = 2 * BoardT<N>::count(replies) + 2 * BoardT<N>::count(replies & corners) -
+                      ((BoardT<N>::bit(sq) & corners) ? 3 : 0);
+            if (empties > SORT_SEARCH)
+            {
+                key = 16 * shallow(next_O, next_P, (empties > SORT_SEARCH + 6) ? 2 : 1,
+                                   -1000, 1000) + key;
+            }
+            if (sq == tt_move)
+            {
+                key = -100000;
+            }
+            int k = n++;
+            while (k > 0 && keys[k - 1] > key)
+            {
+                keys[k] = keys[k - 1];
+                order[k] = order[k - 1];
+                --k;
+            }
+            keys[k] = key;
+            order[k] = sq;
+        }
+
+        int alpha_orig = alpha;
+        int best_value = -BoardT<N>::SQUARES - 1;
+        int best_move = -1;
+        for (int k = 0; k < n; ++k)
+        {
+            int sq = order[k];
+            Bits f = BoardT<N>::flips(P, O, sq);
+            Bits next_P = P | f | BoardT<N>::bit(sq);
+            Bits next_O = O & ~f;
+
+            int value;
+            if (k == 0)
+            {
+                value = -search(next_O, next_P, -beta, -alpha, false);
+            }
+            else
+            {
+                value = -search(next_O, next_P, -alpha - 1, -alpha, false);
+                if (value > alpha && value < beta)
+                {
+                    value = -search(next_O, next_P, -beta, -value, false);
+                }
+            }
+
+            if (value > best_value)
+            {
+                best_value = value;
+                best_move = sq;
+            }
+            alpha = max(alpha, value);
+            if (alpha >= beta)
+            {
+                break;
+            }
+        }
+
+        if (aborted)
+        {
+            return 0;
+        }
+        if (best_value <= alpha_orig)
+        {
+            store(P, O, empties, -BoardT<N>::SQUARES, best_value, best_move);
+        }
+        else if (best_value >= beta)
+        {
+            store(P, O, empties, best_value, BoardT<N>::SQUARES, best_move);
+        }
+        else
+        {
+            store(P, O, empties, best_value, best_value, best_move);
+        }
+
+        if (best != nullptr)
+        {
+            *best = best_move;
+        }
+        return best_value;
+    }
+
+private:
+    struct Entry
+    {
+        Bits P, O;
+        int8_t lower, upper;
+        int8_t move;
+        int8_t empties;
+    };
+
+    Entry *table;
+    bool owned;
+    size_t mask;
+    long long next_check;
+
+    Solver(const Solver &);
+    Solver &operator=(const Solver &);
+
+    void init()
+    {
+        nodes = 0;
+        limited = false;
+        stop = nullptr;
+        aborted = false;
+        next_check = 0;
+    }
+
+    /*
+     * The table is two-way: a position lives in either slot of its pair,
+     * and a new position displaces the one with fewer empties, so that the
+     * expensive entries near the root survive the flood of endgame ones.
+     */
+    Entry *probe(Bits P, Bits O)
+    {
+        Entry *slot = &table[hash(P, O) & mask & ~(size_t) 1];
+        for (int i = 0; i < 2; ++i)
+        {
+            if (slot[i].P == P && slot[i].O == O)
+            {
+                return &slot[i];
+            }
+        }
+        return nullptr;
+    }
+
+    /*
+     * Merges the bounds lower and upper into the entry for P and O.
+     */
+    void store(Bits P, Bits O, int empties, int lower, int upper, int move)
+    {
+        Entry *e = probe(P, O);
+        if (e == nullptr)
+        {
+            Entry *slot = &table[hash(P, O) & mask & ~(size_t) 1];
+            e = (slot[0].empties <= slot[1].empties) ? &slot[0] : &slot[1];
+            e->P = P;
+            e->O = O;
+            e->lower = -BoardT<N>::SQUARES;
+            e->upper = BoardT<N>::SQUARES;
+            e->empties = empties;
+        }
+        e->lower = max((int) e->lower, lower);
+        e->upper = min((int) e->upper, upper);
+        e->move = move;
+    }
+
+    /*
+     * Heuristic score of P to move after depth plies, for move ordering:
+     * mobility and corners.
+     */
+    int shallow(Bits P, Bits O, int depth, int alpha, int beta)
+    {
+        const Bits corners = BoardT<N>::bit(0) | BoardT<N>::bit(N - 1) |
+                             BoardT<N>::bit(N * (N - 1)) | BoardT<N>::bit(N * N - 1);
+        Bits moves = BoardT<N>::moves(P, O);
+        if (depth == 0 || moves == 0)
+        {
+            Bits replies = BoardT<N>::moves(O, P);
+            return BoardT<N>::count(moves) - BoardT<N>::count(replies) +
+                   4 * (BoardT<N>::count(P & corners) - BoardT<N>::count(O & corners));
+        }
+        int best_value = -1000;
+        while (moves)
+        {
+            int sq = BoardT<N>::first(moves);
+            moves &= moves - 1;
+            Bits f = BoardT<N>::flips(P, O, sq);
+            int value = -shallow(O & ~f, P | f | BoardT<N>::bit(sq), depth - 1, -beta, -alpha);
+            best_value = max(best_value, value);
+            alpha = max(alpha, value);
+            if (alpha >= beta)
+            {
+                break;
+            }
+        }
+        return best_value;
+    }
+
+    /*
+     * b mirrored by t: bit 0 flips x, bit 1 flips y and bit 2 swaps them.
+     */
+    static Bits transform(Bits b, int t)
+    {
+        Bits result = 0;
+        while (b)
+        {
+            int sq = BoardT<N>::first(b);
+            b &= b - 1;
+            int x = sq % N;
+            int y = sq / N;
+            if (t & 1)
+            {
+                x = N - 1 - x;
+            }
+            if (t & 2)
+            {
+                y = N - 1 - y;
+            }
+            if (t & 4)
+            {
+                swap(x, y);
+            }
+            result |= BoardT<N>::bit(x + N * y);
+        }
+        return result;
+    }
+
+    /*
+     * The moves that are not the mirror image of a lower-numbered move
+     * under a symmetry of the position.
+     */
+    static Bits uniqueMoves(Bits P, Bits O, Bits moves)
+    {
+        int symmetries[7];
+        int n = 0;
+        for (int t = 1; t < 8; ++t)
+        {
+            if (transform(P, t) == P && transform(O, t) == O)
+            {
+                symmetries[n++] = t;
+            }
+        }
+
+        Bits unique = moves;
+        while (moves)
+        {
+            int sq = BoardT<N>::first(moves);
+            moves &= moves - 1;
+            for (int k = 0; k < n; ++k)
+            {
+                if (BoardT<N>::first(transform(BoardT<N>::bit(sq), symmetries[k])) < sq)
+                {
+                    unique &= ~BoardT<N>::bit(sq);
+                }
+            }
+        }
+        return unique;
+    }
+
+    static uint64_t hash(Bits P, Bits O)
+    {
+        uint64_t h = (uint64_t) P * 0x9e3779b97f4a7c15ULL;
+        h ^= (uint64_t) O * 0xc2b2ae3d27d4eb4fULL;
+        if (sizeof(Bits) > 8)
+        {
+            h ^= (uint64_t) (P >> 32 >> 32) * 0x165667b19e3779f9ULL;
+            h ^= (uint64_t) (O >> 32 >> 32) * 0x27d4eb2f165667c5ULL;
+        }
+        // The products only carry low bits upwards; fold the high half
+        // back down before the table index takes the low bits.
+        h ^= h >> 32;
+        h *= 0xd6e8feb86659fd93ULL;
+        return h ^ (h >> 32);
+    }
+
+    static int finalScore(Bits P, Bits O)
+    {
+        int p = BoardT<N>::count(P);
+        int o = BoardT<N>::count(O);
+        int empties = BoardT<N>::SQUARES - p - o;
+        return (p > o) ? p - o + empties : (p < o) ? p - o - empties : 0;
+    }
+
+    int searchShallow(Bits P, Bits O, int empties, int alpha, int beta, bool passed)
+    {
+        ++nodes;
+        if (empties == 1)
+        {
+            return lastMove(P, O);
+        }
+
+        Bits moves = BoardT<N>::moves(P, O);
+        if (moves == 0)
+        {
+            if (passed)
+            {
+                return finalScore(P, O);
+            }
+            return -searchShallow(O, P, empties, -beta, -alpha, true);
+        }
+
+        int best_value = -BoardT<N>::SQUARES - 1;
+        while (moves)
+        {
+            int sq = BoardT<N>::first(moves);
+            moves &= moves - 1;
+            Bits f = BoardT<N>::flips(P, O, sq);
+            int value = -searchShallow(O & ~f, P | f | BoardT<N>::bit(sq), empties - 1,
+                                       -beta, -alpha, false);
+            best_value = max(best_value, value);
+            alpha = max(alpha, value);
+            if (alpha >= beta)
+            {
+                break;
+            }
+        }
+        return best_value;
+    }
+
+    /*
+     * Final score with one square left: whoever can play it does, P first,
+     * and counting the flips is all it takes.
+     */
+    static int lastMove(Bits P, Bits O)
+    {
+        int sq = BoardT<N>::first(~(P | O) & BoardT<N>::fullMask());
+        Bits f = BoardT<N>::flips(P, O, sq);
+        if (f)
+        {
+            return 2 * (BoardT<N>::count(P | f) + 1) - BoardT<N>::SQUARES;
+        }
+        f = BoardT<N>::flips(O, P, sq);
+        if (f)
+        {
+            return BoardT<N>::SQUARES - 2 * (BoardT<N>::count(O | f) + 1);
+        }
+        return finalScore(P, O);
+    }
+};
+
+/*
+ * Heuristic score of P to move against O for the fixed-depth player:
+ * corners, mobility and, once the board is full, the disc count.
+ */
+template <int N>
+int evaluateT(typename BoardT<N>::Bits P, typename BoardT<N>::Bits O)
+{
+    typedef typename BoardT<N>::Bits Bits;
+    const Bits corners = BoardT<N>::bit(0) | BoardT<N>::bit(N - 1) |
+                         BoardT<N>::bit(N * (N - 1)) | BoardT<N>::bit(N * N - 1);
+    return 16 * (BoardT<N>::count(P & corners) - BoardT<N>::count(O & corners)) +
+           2 * (BoardT<N>::count(BoardT<N>::moves(P, O)) - BoardT<N>::count(BoardT<N>::moves(O, P)));
+}
+
+/*
+ * Fixed-depth negamax alpha-beta with evaluateT at the leaves, switching to
+ * the exact solver once at most endgame squares are empty. Finished games
+ * score 1000 per disc so that they outrank any evaluation.
+ */
+template <int N>
+int searchT(Solver<N> &solver, typename BoardT<N>::Bits P, typename BoardT<N>::Bits O,
+            int depth, int endgame, int alpha, int beta, bool passed = false)
+{
+    typedef typename BoardT<N>::Bits Bits;
+    int empties = BoardT<N>::SQUARES - BoardT<N>::count(P | O);
+    if (empties <= endgame)
+    {
+        int a = (alpha <= -1000 * BoardT<N>::SQUARES) ? -BoardT<N>::SQUARES : alpha / 1000 - 1;
+        int b = (beta >= 1000 * BoardT<N>::SQUARES) ? BoardT<N>::SQUARES : beta / 1000 + 1;
+        return 1000 * solver.search(P, O, a, b, false);
+    }
+    if (depth == 0)
+    {
+        return evaluateT<N>(P, O);
+    }
+
+    Bits moves = BoardT<N>::moves(P, O);
+    if (moves == 0)
+    {
+        if (passed)
+        {
+            return 1000 * (BoardT<N>::count(P) - BoardT<N>::count(O));
+        }
+        return -searchT(solver, O, P, depth - 1, endgame, -beta, -alpha, true);
+    }
+
+    int best_value = -1000 * BoardT<N>::SQUARES - 1;
+    while (moves)
+    {
+        int sq = BoardT<N>::first(moves);
+        moves &= moves - 1;
+        Bits f = BoardT<N>::flips(P, O, sq);
+        int value = -searchT(solver, O & ~f, P | f | BoardT<N>::bit(sq), depth - 1, endgame,
+                             -beta, -alpha);
+        best_value = max(best_value, value);
+        alpha = max(alpha, value);
+        if (alpha >= beta)
+        {
+            break;
+        }
+    }
+    return best_value;
+}
+
+#endif
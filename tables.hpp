@@ -0,0 +1,62 @@
+#ifndef __TABLES_H__
+#define __TABLES_H__
+
+#include <cstdint>
+
+/*
+ * Lookup tables shared by the evaluation and the search. Everything here is
+ * constexpr, so the tables are built by the compiler and sit in .rodata: the
+ * engine does no table set-up at startup before sending "Init done".
+ */
+
+// Adapted from:
+// https://courses.cs.washington.edu/courses/cse573/04au/Project/mini1/RUSSIA/Final_Paper.pdf
+constexpr int static_scores[64] =
+{
+       20, -3, 11, 8, 8, 11, -3, 20,
+      -3, -7, -4, 1, 1, -4, -7, -3,
+       11, -4, 2, 2, 2, 2, -4, 11,
+       8, 1, 2, -3, -3, 2, 1, 8,
+       8, 1, 2, -3, -3, 2, 1, 8,
+       11, -4, 2, 2, 2, 2, -4, 11,
+      -3, -7, -4, 1, 1, -4, -7, -3,
+       20, -3, 11, 8, 8, 11, -3, 20
+};
+
+/*
+ * Output i of the splitmix64 generator with the given seed.
+ */
+constexpr uint64_t splitmix64(uint64_t seed, uint64_t i)
+{
+    uint64_t z = seed + (i + 1) * 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/*
+ * Zobrist keys for hashing positions: one per square for each colour
+ * (indexed by Side) and one for the side to move.
+ */
+struct ZobristKeys {
+    uint64_t square[2][64];
+    uint64_t side;
+};
+
+constexpr ZobristKeys makeZobristKeys()
+{
+    ZobristKeys keys = {};
+    for (int side = 0; side < 2; ++side)
+    {
+        for (int sq = 0; sq < 64; ++sq)
+        {
+            keys.square[side][sq] = splitmix64(0x0123456789abcdefULL, side * 64 + sq);
+        }
+    }
+    keys.side = splitmix64(0x0123456789abcdefULL, 128);
+    return keys;
+}
+
+constexpr ZobristKeys zobrist = makeZobristKeys();
+
+#endif
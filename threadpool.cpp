@@ -0,0 +1,112 @@
+#include "threadpool.hpp"
+
+/*
+ * Starts threads - 1 workers; the thread calling parallelFor is the last.
+ */
+ThreadPool::ThreadPool(int threads)
+{
+    stopping = false;
+    for (int i = 1; i < threads; ++i)
+    {
+        workers.push_back(thread(&ThreadPool::workerLoop, this));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    job_ready.notify_all();
+    for (uint i = 0; i < workers.size(); ++i)
+    {
+        workers[i].join();
+    }
+}
+
+int ThreadPool::size()
+{
+    return workers.size() + 1;
+}
+
+/*
+ * Runs items of job until none are left to claim.
+ */
+void ThreadPool::runItems(PoolJob *job)
+{
+    size_t i;
+    while ((i = job->next.fetch_add(1)) < job->n)
+    {
+        job->work(i);
+        job->done.fetch_add(1);
+    }
+}
+
+void ThreadPool::workerLoop()
+{
+    unique_lock<mutex> guard(lock);
+    while (true)
+    {
+        job_ready.wait(guard, [this]() { return stopping || !jobs.empty(); });
+        if (stopping)
+        {
+            return;
+        }
+
+        PoolJob *job = jobs.front();
+        if (job->next >= job->n)
+        {
+            // Everything is claimed; leave the rest to the threads running it.
+            jobs.pop_front();
+            continue;
+        }
+
+        // The submitter keeps job alive until active drops back to zero.
+        ++job->active;
+        guard.unlock();
+        runItems(job);
+        guard.lock();
+        --job->active;
+        job_done.notify_all();
+    }
+}
+
+/*
+ * Calls work(i) for every i in [0, n) on the pool and returns when all calls
+ * have finished.
+ */
+void ThreadPool::parallelFor(size_t n, function<void(size_t)> work)
+{
+    if (n == 0)
+    {
+        return;
+    }
+
+    PoolJob job;
+    job.work = work;
+    job.n = n;
+    job.next = 0;
+    job.done = 0;
+    job.active = 0;
+
+    if (n > 1 && !workers.empty())
+    {
+        lock_guard<mutex> guard(lock);
+        jobs.push_back(&job);
+        job_ready.notify_all();
+    }
+
+    runItems(&job);
+
+    unique_lock<mutex> guard(lock);
+    job_done.wait(guard, [&job]() { return job.done == job.n && job.active == 0; });
+    for (deque<PoolJob *>::iterator it = jobs.begin(); it != jobs.end(); ++it)
+    {
+        if (*it == &job)
+        {
+            jobs.erase(it);
+            break;
+        }
+    }
+}
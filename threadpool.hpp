@@ -0,0 +1,53 @@
+#ifndef __THREADPOOL_H__
+#define __THREADPOOL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/*
+ * A batch of n independent work items, handed out one index at a time.
+ */
+struct PoolJob {
+    function<void(size_t)> work;
+    size_t n;
+    atomic<size_t> next;
+    atomic<size_t> done;
+    // Workers currently running items of the job, guarded by the pool lock.
+    int active;
+};
+
+/*
+ * Fixed set of worker threads running parallelFor batches. Several threads
+ * may submit batches at once; the workers serve them in arrival order and
+ * each caller helps with its own batch while it waits.
+ */
+class ThreadPool {
+public:
+    ThreadPool(int threads);
+    ~ThreadPool();
+
+    void parallelFor(size_t n, function<void(size_t)> work);
+
+    int size();
+
+private:
+    void workerLoop();
+    static void runItems(PoolJob *job);
+
+    vector<thread> workers;
+    deque<PoolJob *> jobs;
+    mutex lock;
+    condition_variable job_ready;
+    condition_variable job_done;
+    bool stopping;
+};
+
+#endif
@@ -0,0 +1,90 @@
+#include "transposition.hpp"
+#include "memory.hpp"
+#include "profiler.hpp"
+#include <cstring>
+#include <iostream>
+
+TranspositionTable::TranspositionTable(size_t bytes)
+{
+    age = 0;
+
+    // Entries need no construction: the memory comes zeroed and a zero key
+    // never matches a position with stones on it.
+    size_t actual;
+    entries = (TTEntry *) MemoryBudget::instance().allocate("tt", bytes, 1 << 20, &actual);
+    heap_entries = (entries == nullptr);
+    if (heap_entries)
+    {
+        cerr << "tt: allocation failed, using a small heap table" << endl;
+        actual = 4096 * sizeof(TTEntry);
+        entries = new TTEntry[4096]();
+    }
+
+    size_t count = 1;
+    while (2 * count * sizeof(TTEntry) <= actual)
+    {
+        count *= 2;
+    }
+    mask = count - 1;
+}
+
+TranspositionTable::~TranspositionTable()
+{
+    if (heap_entries)
+    {
+        delete[] entries;
+    }
+    else
+    {
+        MemoryBudget::instance().release(entries);
+    }
+}
+
+size_t TranspositionTable::size()
+{
+    return mask + 1;
+}
+
+/*
+ * Copies the entry for key into entry. Returns false if there is none.
+ */
+bool TranspositionTable::probe(uint64_t key, TTEntry *entry)
+{
+    PROFILE_SCOPE(PHASE_TT);
+    TTEntry &e = entries[key & mask];
+    if (e.key != key)
+    {
+        return false;
+    }
+    *entry = e;
+    return true;
+}
+
+void TranspositionTable::store(uint64_t key, int depth, double value, int bound, int move)
+{
+    PROFILE_SCOPE(PHASE_TT);
+    TTEntry &e = entries[key & mask];
+    if (e.key == key || e.age != age || depth >= e.depth)
+    {
+        e.key = key;
+        e.value = value;
+        e.depth = depth;
+        e.bound = bound;
+        e.move = move;
+        e.age = age;
+    }
+}
+
+/*
+ * Marks the entries stored so far as old, so that the next search may
+ * overwrite them whatever their depth.
+ */
+void TranspositionTable::newSearch()
+{
+    ++age;
+}
+
+void TranspositionTable::clear()
+{
+    memset(entries, 0, size() * sizeof(TTEntry));
+}
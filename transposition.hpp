@@ -0,0 +1,55 @@
+#ifndef __TRANSPOSITION_H__
+#define __TRANSPOSITION_H__
+
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+// Best move of an entry that has none (a pass, or a node that failed low).
+#define TT_NONE 64
+
+enum TTBound {
+    TT_EXACT, TT_LOWER, TT_UPPER
+};
+
+/*
+ * One searched node. value is from the searching player's point of view,
+ * like every score in getABScore, and bound says whether it is exact or
+ * only a lower or upper bound on the true score at that depth.
+ */
+struct TTEntry {
+    uint64_t key;
+    double value;
+    int8_t depth;
+    uint8_t bound;
+    uint8_t move;
+    uint8_t age;
+};
+
+/*
+ * Transposition table for the alpha-beta search: a power of two of entries
+ * taken from the memory budget, one entry per slot. An entry is replaced by
+ * one at least as deep or by anything once it is left over from an earlier
+ * search.
+ */
+class TranspositionTable {
+public:
+    TranspositionTable(size_t bytes);
+    ~TranspositionTable();
+
+    bool probe(uint64_t key, TTEntry *entry);
+    void store(uint64_t key, int depth, double value, int bound, int move);
+    void newSearch();
+    void clear();
+
+    size_t size();
+
+private:
+    TTEntry *entries;
+    size_t mask;
+    uint8_t age;
+    bool heap_entries;
+};
+
+#endif
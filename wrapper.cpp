@@ -2,18 +2,73 @@
 #include <cstdlib>
 #include <cstring>
 #include "player.hpp"
+#include "distributed.hpp"
+#include "profiler.hpp"
+#include "memory.hpp"
 using namespace std;
 
 int main(int argc, char *argv[]) {
+    // Serve root-split searches for distsearch instead of playing a game,
+    // on the loopback interface unless an address is given with the port.
+    if (argc == 3 && !strcmp(argv[1], "--worker")) {
+        string address = argv[2];
+        size_t colon = address.rfind(':');
+        if (colon == string::npos) {
+            return runWorker(WORKER_DEFAULT_HOST, atoi(address.c_str()));
+        }
+        return runWorker(address.substr(0, colon), atoi(address.c_str() + colon + 1));
+    }
+
     // Read in side the player is on.
-    if (argc != 2)  {
-        cerr << "usage: " << argv[0] << " side" << endl;
+    if (argc < 2)  {
+        cerr << "usage: " << argv[0] << " side [--mcts] [--depth N] [--no-watchdog] [--memory MB]"
+             << " [--nnue weights] [--book file] [--param name=value]" << endl;
+        cerr << "       " << argv[0] << " --worker [host:]port" << endl;
         exit(-1);
     }
     Side side = (!strcmp(argv[1], "Black")) ? BLACK : WHITE;
 
     // Initialize player.
     Player *player = new Player(side);
+    for (int i = 2; i < argc; i++) {
+        if (!strcmp(argv[i], "--mcts")) {
+            player->useMCTS = true;
+        } else if (!strcmp(argv[i], "--depth") && i + 1 < argc) {
+            player->depth = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--book") && i + 1 < argc) {
+            player->book_file = argv[++i];
+        } else if (!strcmp(argv[i], "--no-watchdog")) {
+            player->useWatchdog = false;
+        } else if (!strcmp(argv[i], "--nnue") && i + 1 < argc) {
+            player->useNNUE = true;
+            player->nnue_file = argv[++i];
+        } else if (!strcmp(argv[i], "--memory") && i + 1 < argc) {
+            MemoryBudget::instance().setTotal((size_t) atoi(argv[++i]) << 20);
+        } else if (!strcmp(argv[i], "--param") && i + 1 < argc) {
+            // A search parameter, as in Player::setSearchParam.
+            string setting = argv[++i];
+            size_t eq = setting.find('=');
+            if (eq == string::npos ||
+                !player->setSearchParam(setting.substr(0, eq), atof(setting.c_str() + eq + 1))) {
+                cerr << "unknown search parameter " << setting << endl;
+                exit(-1);
+            }
+        } else {
+            cerr << "unknown option " << argv[i] << endl;
+            exit(-1);
+        }
+    }
+
+    // If the watchdog has to answer for a search that runs too long, the
+    // reply goes out from its thread and the main loop must not send
+    // another.
+    player->onReply = [](Move *m) {
+        cout << m->x << " " << m->y << endl;
+        cout.flush();
+    };
+
+    player->allocateTables();
+    MemoryBudget::instance().report(cerr);
 
     // Tell java wrapper that we are done initializing.
     cout << "Init done" << endl;
@@ -29,8 +84,15 @@ int main(int argc, char *argv[]) {
         }
 
         // Get player's move and output to java wrapper.
-        Move *playersMove = player->doMove(opponentsMove, msLeft);
-        if (playersMove != nullptr) {
+        Move *playersMove;
+        {
+            PROFILE_SCOPE(PHASE_SEARCH);
+            playersMove = player->doMove(opponentsMove, msLeft);
+        }
+        PROFILE_END_MOVE(cerr, player->turns_taken);
+        if (player->replied) {
+            // Already sent by the watchdog.
+        } else if (playersMove != nullptr) {
             cout << playersMove->x << " " << playersMove->y << endl;
         } else {
             cout << "-1 -1" << endl;
@@ -43,5 +105,7 @@ int main(int argc, char *argv[]) {
         if (playersMove != nullptr) delete playersMove;
     }
 
+    PROFILE_END_GAME(cerr);
+    delete player;
     return 0;
 }